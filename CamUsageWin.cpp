@@ -1,341 +1,5580 @@
-﻿// CamUsageWin.cpp
-// Windows Desktop app (Win32) that shows current & recent webcam usage.
-// Reads HKCU\Software\Microsoft\Windows\CurrentVersion\CapabilityAccessManager\ConsentStore\webcam
-// and ...\NonPackaged\ for classic desktop apps.
-//
-// UI:
-//  - ListView with columns: Kind, App, EXE, Active, Last Start, Last Stop
-//  - [Refresh] button
-//  - [ ] Current only (filters to active sessions)
-//  - Status bar: "Ready - Bob Paydar"
-//
-// Build: Visual Studio 2022 → Win32 Project (Empty), add this file, set /DUNICODE /D_UNICODE.
-// Programmer: Bob Paydar
-
-#include <windows.h>
-#include <windowsx.h>
-#include <commctrl.h>
-#include <string>
-#include <vector>
-#include <algorithm>
-
-#pragma comment(lib, "comctl32.lib")
-
-// ---------------------- Constants & IDs ----------------------
-const wchar_t kAppClass[] = L"CamUsageWin32App";
-const wchar_t kAppTitle[] = L"Camera Usage Viewer (Win32)";
-
-#define IDC_LIST        1001
-#define IDC_REFRESH     1002
-#define IDC_CURONLY     1003
-#define IDC_STATUS      1004
-
-// Registry base
-const wchar_t* const REG_WEBCAM_BASE =
-L"Software\\Microsoft\\Windows\\CurrentVersion\\CapabilityAccessManager\\ConsentStore\\webcam";
-
-// ---------------------- Data Model --------------------------
-struct CamRow {
-    std::wstring kind;         // "Packaged" | "Desktop"
-    std::wstring app;          // App key or friendly name
-    std::wstring exe;          // Full path for Desktop (NonPackaged) apps
-    bool         activeNow{ false };
-    ULONGLONG    startFt{ 0 }; // FILETIME (100ns since 1601), UTC
-    ULONGLONG    stopFt{ 0 };  // FILETIME (0 => still active)
-};
-
-// Globals
-HINSTANCE g_hInst = nullptr;
-HWND g_hList = nullptr, g_hBtnRefresh = nullptr, g_hChkCurrent = nullptr, g_hStatus = nullptr;
-std::vector<CamRow> g_rows;
-
-// ---------------------- Helpers -----------------------------
-static std::wstring ReplaceAll(const std::wstring& s, wchar_t from, wchar_t to) {
-    std::wstring r = s;
-    std::replace(r.begin(), r.end(), from, to);
-    return r;
-}
-
-static std::wstring LeafName(const std::wstring& path) {
-    size_t pos = path.find_last_of(L"\\/");
-    return (pos == std::wstring::npos) ? path : path.substr(pos + 1);
-}
-
-static std::wstring FtToLocalString(ULONGLONG ft) {
-    if (ft == 0) return L"";
-    FILETIME ftUtc{};
-    ftUtc.dwLowDateTime = static_cast<DWORD>(ft & 0xFFFFFFFFULL);
-    ftUtc.dwHighDateTime = static_cast<DWORD>(ft >> 32);
-
-    SYSTEMTIME stUtc{};
-    if (!FileTimeToSystemTime(&ftUtc, &stUtc)) return L"";
-
-    SYSTEMTIME stLocal{};
-    if (!SystemTimeToTzSpecificLocalTime(nullptr, &stUtc, &stLocal)) return L"";
-
-    wchar_t buf[64];
-    swprintf_s(buf, L"%04u-%02u-%02u %02u:%02u:%02u",
-        stLocal.wYear, stLocal.wMonth, stLocal.wDay,
-        stLocal.wHour, stLocal.wMinute, stLocal.wSecond);
-    return buf;
-}
-
-static bool RegGetQword(HKEY hKey, const wchar_t* valueName, ULONGLONG& out) {
-    DWORD type = 0;
-    ULONGLONG val = 0;
-    DWORD cb = sizeof(val);
-    LONG r = RegGetValueW(hKey, nullptr, valueName, RRF_RT_QWORD, &type, &val, &cb);
-    if (r == ERROR_SUCCESS) { out = val; return true; }
-    return false;
-}
-
-static void LoadConsentStore(std::vector<CamRow>& out) {
-    out.clear();
-
-    HKEY hBase = nullptr;
-    if (RegOpenKeyExW(HKEY_CURRENT_USER, REG_WEBCAM_BASE, 0, KEY_READ, &hBase) != ERROR_SUCCESS) {
-        return;
-    }
-
-    DWORD index = 0;
-    wchar_t name[512];
-    DWORD nameLen;
-    FILETIME ftDummy{};
-    while (true) {
-        nameLen = static_cast<DWORD>(std::size(name));
-        LONG rr = RegEnumKeyExW(hBase, index++, name, &nameLen, nullptr, nullptr, nullptr, &ftDummy);
-        if (rr == ERROR_NO_MORE_ITEMS) break;
-        if (rr != ERROR_SUCCESS) continue;
-
-        std::wstring subkey = name;
-        if (_wcsicmp(subkey.c_str(), L"NonPackaged") == 0) {
-            // Desktop apps
-            HKEY hNp = nullptr;
-            if (RegOpenKeyExW(hBase, L"NonPackaged", 0, KEY_READ, &hNp) == ERROR_SUCCESS) {
-                DWORD idx2 = 0;
-                wchar_t n2[1024]; DWORD n2len;
-                while (true) {
-                    n2len = static_cast<DWORD>(std::size(n2));
-                    LONG r2 = RegEnumKeyExW(hNp, idx2++, n2, &n2len, nullptr, nullptr, nullptr, &ftDummy);
-                    if (r2 == ERROR_NO_MORE_ITEMS) break;
-                    if (r2 != ERROR_SUCCESS) continue;
-
-                    HKEY hItem = nullptr;
-                    if (RegOpenKeyExW(hNp, n2, 0, KEY_READ, &hItem) == ERROR_SUCCESS) {
-                        ULONGLONG start = 0, stop = 0;
-                        RegGetQword(hItem, L"LastUsedTimeStart", start);
-                        RegGetQword(hItem, L"LastUsedTimeStop", stop);
-                        RegCloseKey(hItem);
-
-                        std::wstring raw = n2;
-                        std::wstring exe = ReplaceAll(raw, L'#', L'\\');
-                        CamRow row;
-                        row.kind = L"Desktop";
-                        row.exe = exe;
-                        row.app = LeafName(exe);
-                        row.startFt = start;
-                        row.stopFt = stop;
-                        row.activeNow = (start != 0) && (stop == 0);
-                        out.push_back(std::move(row));
-                    }
-                }
-                RegCloseKey(hNp);
-            }
-        }
-        else {
-            // Packaged apps
-            HKEY hChild = nullptr;
-            if (RegOpenKeyExW(hBase, subkey.c_str(), 0, KEY_READ, &hChild) == ERROR_SUCCESS) {
-                ULONGLONG start = 0, stop = 0;
-                RegGetQword(hChild, L"LastUsedTimeStart", start);
-                RegGetQword(hChild, L"LastUsedTimeStop", stop);
-                RegCloseKey(hChild);
-
-                CamRow row;
-                row.kind = L"Packaged";
-                row.app = subkey;
-                row.exe = L"";
-                row.startFt = start;
-                row.stopFt = stop;
-                row.activeNow = (start != 0) && (stop == 0);
-                out.push_back(std::move(row));
-            }
-        }
-    }
-
-    RegCloseKey(hBase);
-
-    std::sort(out.begin(), out.end(), [](const CamRow& a, const CamRow& b) {
-        if (a.activeNow != b.activeNow) return a.activeNow > b.activeNow;
-        return a.startFt > b.startFt;
-        });
-}
-
-static void ListView_SetupColumns(HWND hList) {
-    ListView_DeleteAllItems(hList);
-    while (ListView_DeleteColumn(hList, 0)) {}
-
-    LVCOLUMNW col{};
-    col.mask = LVCF_TEXT | LVCF_WIDTH | LVCF_SUBITEM;
-
-    col.pszText = const_cast<wchar_t*>(L"Kind"); col.cx = 90; col.iSubItem = 0;
-    ListView_InsertColumn(hList, 0, &col);
-
-    col.pszText = const_cast<wchar_t*>(L"App"); col.cx = 200; col.iSubItem = 1;
-    ListView_InsertColumn(hList, 1, &col);
-
-    col.pszText = const_cast<wchar_t*>(L"EXE"); col.cx = 360; col.iSubItem = 2;
-    ListView_InsertColumn(hList, 2, &col);
-
-    col.pszText = const_cast<wchar_t*>(L"Active"); col.cx = 70; col.iSubItem = 3;
-    ListView_InsertColumn(hList, 3, &col);
-
-    col.pszText = const_cast<wchar_t*>(L"Last Start"); col.cx = 140; col.iSubItem = 4;
-    ListView_InsertColumn(hList, 4, &col);
-
-    col.pszText = const_cast<wchar_t*>(L"Last Stop"); col.cx = 140; col.iSubItem = 5;
-    ListView_InsertColumn(hList, 5, &col);
-}
-
-static void ListView_Populate(HWND hList, const std::vector<CamRow>& src, bool currentOnly) {
-    ListView_DeleteAllItems(hList);
-
-    int i = 0;
-    for (const auto& r : src) {
-        if (currentOnly && !r.activeNow) continue;
-
-        std::wstring active = r.activeNow ? L"Yes" : L"No";
-        std::wstring startS = FtToLocalString(r.startFt);
-        std::wstring stopS = FtToLocalString(r.stopFt);
-
-        LVITEMW item{};
-        item.mask = LVIF_TEXT;
-        item.iItem = i;
-        item.pszText = const_cast<wchar_t*>(r.kind.c_str());
-        int idx = ListView_InsertItem(hList, &item);
-
-        ListView_SetItemText(hList, idx, 1, const_cast<wchar_t*>(r.app.c_str()));
-        ListView_SetItemText(hList, idx, 2, const_cast<wchar_t*>(r.exe.c_str()));
-        ListView_SetItemText(hList, idx, 3, const_cast<wchar_t*>(active.c_str()));
-        ListView_SetItemText(hList, idx, 4, const_cast<wchar_t*>(startS.c_str()));
-        ListView_SetItemText(hList, idx, 5, const_cast<wchar_t*>(stopS.c_str()));
-
-        ++i;
-    }
-}
-
-static void DoRefresh(HWND hWnd) {
-    LoadConsentStore(g_rows);
-    BOOL curOnly = (Button_GetCheck(g_hChkCurrent) == BST_CHECKED);
-    ListView_Populate(g_hList, g_rows, curOnly);
-    int parts[1] = { -1 };
-    SendMessageW(g_hStatus, SB_SETPARTS, 1, (LPARAM)parts);
-    SendMessageW(g_hStatus, SB_SETTEXT, 0, (LPARAM)L"Ready - Bob Paydar");
-}
-
-static void ResizeLayout(HWND hWnd) {
-    RECT rc{}; GetClientRect(hWnd, &rc);
-
-    SendMessageW(g_hStatus, WM_SIZE, 0, 0);
-    RECT rcStatus{}; GetWindowRect(g_hStatus, &rcStatus);
-    int sbHeight = rcStatus.bottom - rcStatus.top;
-
-    int padding = 8;
-    int btnW = 100, btnH = 28;
-    int chkW = 140, chkH = 24;
-
-    int topBarH = btnH + padding * 2;
-
-    MoveWindow(g_hBtnRefresh, padding, padding, btnW, btnH, TRUE);
-    MoveWindow(g_hChkCurrent, padding + btnW + 10, padding + 2, chkW, chkH, TRUE);
-
-    int listY = topBarH;
-    int listH = rc.bottom - listY - sbHeight;
-    MoveWindow(g_hList, 0, listY, rc.right - rc.left, listH, TRUE);
-}
-
-static void InitListView(HWND hList) {
-    DWORD ex = ListView_GetExtendedListViewStyle(hList);
-    ex |= LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES;
-    ListView_SetExtendedListViewStyle(hList, ex);
-    ListView_SetupColumns(hList);
-}
-
-// ---------------------- Win32 Boilerplate -------------------
-static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    switch (msg) {
-    case WM_CREATE:
-        g_hBtnRefresh = CreateWindowExW(0, L"BUTTON", L"Refresh",
-            WS_CHILD | WS_VISIBLE | WS_TABSTOP,
-            0, 0, 0, 0, hWnd, (HMENU)IDC_REFRESH, g_hInst, nullptr);
-
-        g_hChkCurrent = CreateWindowExW(0, L"BUTTON", L"Current only",
-            WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX | WS_TABSTOP,
-            0, 0, 0, 0, hWnd, (HMENU)IDC_CURONLY, g_hInst, nullptr);
-
-        g_hList = CreateWindowExW(WS_EX_CLIENTEDGE, WC_LISTVIEWW, L"",
-            WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_SHOWSELALWAYS,
-            0, 0, 0, 0, hWnd, (HMENU)IDC_LIST, g_hInst, nullptr);
-
-        g_hStatus = CreateWindowExW(0, STATUSCLASSNAMEW, L"",
-            WS_CHILD | WS_VISIBLE, 0, 0, 0, 0, hWnd, (HMENU)IDC_STATUS, g_hInst, nullptr);
-
-        InitListView(g_hList);
-        ResizeLayout(hWnd);
-        DoRefresh(hWnd);
-        return 0;
-
-    case WM_SIZE:
-        ResizeLayout(hWnd);
-        return 0;
-
-    case WM_COMMAND:
-        switch (LOWORD(wParam)) {
-        case IDC_REFRESH:
-        case IDC_CURONLY:
-            DoRefresh(hWnd);
-            return 0;
-        }
-        break;
-
-    case WM_DESTROY:
-        PostQuitMessage(0);
-        return 0;
-    }
-    return DefWindowProcW(hWnd, msg, wParam, lParam);
-}
-
-int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int nCmdShow) {
-    g_hInst = hInstance;
-
-    INITCOMMONCONTROLSEX icc{ sizeof(icc), ICC_LISTVIEW_CLASSES | ICC_BAR_CLASSES };
-    InitCommonControlsEx(&icc);
-
-    WNDCLASSEXW wc{ sizeof(wc) };
-    wc.lpfnWndProc = WndProc;
-    wc.hInstance = hInstance;
-    wc.hCursor = LoadCursor(nullptr, IDC_ARROW);
-    wc.hIcon = LoadIcon(nullptr, IDI_APPLICATION);
-    wc.hIconSm = wc.hIcon;
-    wc.hbrBackground = (HBRUSH)(COLOR_WINDOW + 1);
-    wc.lpszClassName = kAppClass;
-
-    if (!RegisterClassExW(&wc)) return 0;
-
-    HWND hWnd = CreateWindowExW(0, kAppClass, kAppTitle,
-        WS_OVERLAPPEDWINDOW | WS_VISIBLE,
-        CW_USEDEFAULT, CW_USEDEFAULT, 980, 560,
-        nullptr, nullptr, hInstance, nullptr);
-
-    if (!hWnd) return 0;
-
-    ShowWindow(hWnd, nCmdShow);
-    UpdateWindow(hWnd);
-
-    MSG msg{};
-    while (GetMessageW(&msg, nullptr, 0, 0)) {
-        TranslateMessage(&msg);
-        DispatchMessageW(&msg);
-    }
-    return (int)msg.wParam;
-}
+﻿// CamUsageWin.cpp
+// Windows Desktop app (Win32) that shows current & recent webcam usage.
+// Reads every capability (webcam, microphone, location, ...) under
+// HKCU\Software\Microsoft\Windows\CurrentVersion\CapabilityAccessManager\ConsentStore
+// and their ...\NonPackaged\ subkeys for classic desktop apps.
+//
+// UI:
+//  - ListView with columns: Kind, App, Name, Category, EXE, Product, Company, Version,
+//    SHA-256, Signer, Issuer, Active, Policy, Last Start, Last Stop, Capability, User,
+//    Container
+//  - Name and Category of well-known apps come from a built-in catalog
+//  - [Refresh] button
+//  - [ ] Current only (filters to active sessions)
+//  - [Search] box filtering App/EXE as you type
+//  - Grouping by product, publisher, directory or container (Enter/double-click expands)
+//  - Click a column header to sort by it (again to reverse)
+//  - Status bar: "Ready - Bob Paydar"
+//
+// Terminal:
+//  - CamUsageWin.exe --watch [--current] [--interval ms] renders the same columns
+//    to the console (for Server Core / SSH) and redraws only changed cells
+//  - CamUsageWin.exe --export csv|json writes one scan to stdout
+//  - --search TEXT, --sort COLUMN[:desc] and (watch only) --group BY filter,
+//    order and group the rows as the window does
+//  - --watch --timeline day|week|month draws per-app strips of camera use
+//  - camusage --inspect FILE... (portable build) prints the version resource,
+//    signer and SHA-256 of PE files collected from other machines
+//  - --hash-cache PATH (any mode) keeps the exe hashes somewhere else
+//  - --policy FILE (any mode) classifies every row against allow/deny rules
+//  - --all-users (any mode) scans every profile: the hives loaded under
+//    HKEY_USERS and, via offreg.dll, the NTUSER.DAT of everyone signed out
+//
+// Services:
+//  - Local query server (named pipe \\.\pipe\CamUsageWin, or a Unix socket in
+//    the portable build) answering from the last published snapshot
+//  - Prometheus metrics on http://127.0.0.1:9464/metrics
+//  - Latest snapshot mirrored into shared memory for zero-copy local readers
+//
+// Build: Visual Studio 2022 → Win32 Project (Empty), add this file, set /DUNICODE /D_UNICODE.
+// Portable build (no UI): g++ -std=c++17 -O2 CamUsageWin.cpp -o camusage -lpthread
+// (on Linux it reports processes holding camera and ALSA capture nodes open, from /proc)
+// Programmer: Bob Paydar
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <windowsx.h>
+#include <commctrl.h>
+#include <psapi.h>
+#include <shellapi.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/inotify.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#endif
+#endif
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <map>
+#include <list>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cwctype>
+#include <string_view>
+#include <array>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef _WIN32
+#pragma comment(lib, "comctl32.lib")
+#pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "psapi.lib")
+#pragma comment(lib, "shell32.lib")
+#else
+typedef unsigned long long ULONGLONG;
+#endif
+
+// ---------------------- Constants & IDs ----------------------
+#ifdef _WIN32
+const wchar_t kAppClass[] = L"CamUsageWin32App";
+const wchar_t kAppTitle[] = L"Camera Usage Viewer (Win32)";
+
+#define IDC_LIST        1001
+#define IDC_REFRESH     1002
+#define IDC_CURONLY     1003
+#define IDC_STATUS      1004
+#define IDC_SEARCH      1005
+#define IDC_GROUP       1006
+
+#define WM_APP_HASHED   (WM_APP + 1) // background exe hashing finished
+
+// Registry base: one subkey per capability (webcam, microphone, location, ...)
+const wchar_t* const REG_CONSENT_STORE =
+L"Software\\Microsoft\\Windows\\CurrentVersion\\CapabilityAccessManager\\ConsentStore";
+
+// Local query server endpoint
+const wchar_t kPipeName[] = L"\\\\.\\pipe\\CamUsageWin";
+#endif
+
+// Metrics endpoint (http://127.0.0.1:<port>/metrics)
+const unsigned short kMetricsPort = 9464;
+
+// ---------------------- Data Model --------------------------
+struct CamRow {
+    std::wstring kind;         // "Packaged" | "Desktop"
+    std::wstring capability;   // ConsentStore capability, e.g. "webcam"
+    std::wstring user;         // Profile the row was read from (all-users scan only)
+    std::wstring container;    // Container, sandbox or systemd unit (Linux)
+    std::wstring app;          // App key or friendly name
+    std::wstring name;         // Display name from the Known Apps catalog
+    std::wstring category;     // e.g. "Video calls", likewise
+    std::wstring exe;          // Full path for Desktop (NonPackaged) apps
+    std::wstring product;      // From the exe's version resource (Executable Metadata)
+    std::wstring company;
+    std::wstring version;      // File version, e.g. "30.2.3.0"
+    std::wstring sha256;       // Of the exe (Desktop rows), lowercase hex
+    std::wstring signer;       // Authenticode signer's name, empty if unsigned
+    std::wstring signerIssuer; // and who issued its certificate
+    bool         activeNow{ false };
+    std::wstring policy;       // "allowed" | "denied" | "unlisted" with --policy, else empty
+    ULONGLONG    startFt{ 0 }; // FILETIME (100ns since 1601), UTC
+    ULONGLONG    stopFt{ 0 };  // FILETIME (0 => still active)
+    ULONGLONG    changedIn{ 0 }; // Snapshot version in which this row last changed
+};
+
+// Globals
+#ifdef _WIN32
+HINSTANCE g_hInst = nullptr;
+HWND g_hList = nullptr, g_hBtnRefresh = nullptr, g_hChkCurrent = nullptr, g_hStatus = nullptr;
+HWND g_hSearch = nullptr, g_hGroup = nullptr, g_hMain = nullptr;
+bool g_allUsers = false; // --all-users: scan every profile instead of HKCU
+#endif
+std::vector<CamRow> g_rows;
+
+// ---------------------- Helpers -----------------------------
+#ifdef _WIN32
+static std::wstring ReplaceAll(const std::wstring& s, wchar_t from, wchar_t to) {
+    std::wstring r = s;
+    std::replace(r.begin(), r.end(), from, to);
+    return r;
+}
+#endif
+
+static std::wstring LeafName(const std::wstring& path) {
+    size_t pos = path.find_last_of(L"\\/");
+    return (pos == std::wstring::npos) ? path : path.substr(pos + 1);
+}
+
+static std::wstring FtToLocalString(ULONGLONG ft) {
+    if (ft == 0) return L"";
+#ifdef _WIN32
+    FILETIME ftUtc{};
+    ftUtc.dwLowDateTime = static_cast<DWORD>(ft & 0xFFFFFFFFULL);
+    ftUtc.dwHighDateTime = static_cast<DWORD>(ft >> 32);
+
+    SYSTEMTIME stUtc{};
+    if (!FileTimeToSystemTime(&ftUtc, &stUtc)) return L"";
+
+    SYSTEMTIME stLocal{};
+    if (!SystemTimeToTzSpecificLocalTime(nullptr, &stUtc, &stLocal)) return L"";
+
+    wchar_t buf[64];
+    swprintf_s(buf, L"%04u-%02u-%02u %02u:%02u:%02u",
+        stLocal.wYear, stLocal.wMonth, stLocal.wDay,
+        stLocal.wHour, stLocal.wMinute, stLocal.wSecond);
+    return buf;
+#else
+    const ULONGLONG kUnixEpochFt = 116444736000000000ULL; // 1970-01-01 as FILETIME
+    if (ft < kUnixEpochFt) return L"";
+    time_t t = static_cast<time_t>((ft - kUnixEpochFt) / 10000000ULL);
+    tm lt{};
+    if (!localtime_r(&t, &lt)) return L"";
+
+    wchar_t buf[64];
+    swprintf(buf, std::size(buf), L"%04d-%02d-%02d %02d:%02d:%02d",
+        lt.tm_year + 1900, lt.tm_mon + 1, lt.tm_mday,
+        lt.tm_hour, lt.tm_min, lt.tm_sec);
+    return buf;
+#endif
+}
+
+constexpr ULONGLONG kTicksPerSecond = 10000000ULL; // FILETIME ticks
+
+// Current time as FILETIME ticks.
+static ULONGLONG NowFt() {
+#ifdef _WIN32
+    FILETIME ft{};
+    GetSystemTimeAsFileTime(&ft);
+    return (static_cast<ULONGLONG>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+#else
+    timespec ts{};
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return 116444736000000000ULL + static_cast<ULONGLONG>(ts.tv_sec) * kTicksPerSecond +
+        static_cast<ULONGLONG>(ts.tv_nsec) / 100;
+#endif
+}
+
+static wchar_t FoldChar(wchar_t c) {
+    if (c < 0x80) return (c >= L'A' && c <= L'Z') ? static_cast<wchar_t>(c + 32) : c;
+    return static_cast<wchar_t>(towlower(c));
+}
+
+static ULONGLONG FoldedPrefix(const std::wstring& s) {
+    ULONGLONG k = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        ULONGLONG c = i < s.size() ? static_cast<ULONGLONG>(FoldChar(s[i])) : 0;
+        k = (k << 16) | std::min<ULONGLONG>(c, 0xFFFF);
+    }
+    return k;
+}
+
+// Case-folded comparison of a and b starting at index from (the characters
+// before it are known to be equal, e.g. from FoldedPrefix).
+static int CompareFolded(const std::wstring& a, const std::wstring& b, size_t from) {
+    size_t n = std::min(a.size(), b.size());
+    for (size_t i = from; i < n; ++i) {
+        wchar_t ca = FoldChar(a[i]), cb = FoldChar(b[i]);
+        if (ca != cb) return ca < cb ? -1 : 1;
+    }
+    return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+}
+
+static void AppendUtf8(std::string& out, std::wstring_view s) {
+    for (size_t i = 0; i < s.size(); ++i) {
+        uint32_t c = static_cast<uint32_t>(s[i]);
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < s.size()) {
+            // UTF-16 surrogate pair (wchar_t is 16-bit on Windows)
+            uint32_t lo = static_cast<uint32_t>(s[i + 1]);
+            if (lo >= 0xDC00 && lo <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+                ++i;
+            }
+        }
+        if (c < 0x80) {
+            out += static_cast<char>(c);
+        }
+        else if (c < 0x800) {
+            out += static_cast<char>(0xC0 | (c >> 6));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else if (c < 0x10000) {
+            out += static_cast<char>(0xE0 | (c >> 12));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xF0 | (c >> 18));
+            out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+}
+
+// Decodes UTF-8 (paths are bytes; invalid sequences become U+FFFD).
+static void AppendWide(std::wstring& out, std::string_view s) {
+    for (size_t i = 0; i < s.size();) {
+        uint32_t c = static_cast<unsigned char>(s[i]);
+        size_t n = c < 0x80 ? 1 : (c >> 5) == 6 ? 2 : (c >> 4) == 14 ? 3 : (c >> 3) == 30 ? 4 : 0;
+        if (n == 0 || i + n > s.size()) { out += L'\xFFFD'; ++i; continue; }
+        if (n > 1) c &= 0x3F >> (n - 1);
+        bool ok = true;
+        for (size_t k = 1; k < n; ++k) {
+            uint32_t cc = static_cast<unsigned char>(s[i + k]);
+            if ((cc >> 6) != 2) { ok = false; break; }
+            c = (c << 6) | (cc & 0x3F);
+        }
+        if (!ok) { out += L'\xFFFD'; ++i; continue; }
+        if (sizeof(wchar_t) == 2 && c >= 0x10000) {
+            out += static_cast<wchar_t>(0xD800 + ((c - 0x10000) >> 10));
+            c = 0xDC00 + ((c - 0x10000) & 0x3FF);
+        }
+        out += static_cast<wchar_t>(c);
+        i += n;
+    }
+}
+
+// ---------------------- Column Schema -----------------------
+// The columns are defined once, here. Each entry binds a CamRow field to how
+// it is shown; the ListView, watch mode, sort keys and exporters are generated
+// from the table with one specialization per column, so no per-row code
+// switches on what kind of column it is.
+enum class ColType { Text, Flag, Time };
+
+template <ColType Type, typename T, T CamRow::*Field>
+struct ColumnDef {
+    static constexpr ColType type = Type;
+    static constexpr T CamRow::*field = Field;
+    const wchar_t* title;
+    const char* name; // CSV header / JSON key
+    int listWidth;    // ListView pixels
+    int watchWidth;   // terminal cells, 0 => takes the rest
+    int watchKeep;    // on a narrow terminal, lower values are dropped first
+};
+
+constexpr auto kColumns = std::make_tuple(
+    ColumnDef<ColType::Text, std::wstring, &CamRow::kind>{ L"Kind", "kind", 90, 8, 7 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::app>{ L"App", "app", 200, 24, 10 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::name>{ L"Name", "name", 140, 14, 3 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::category>{ L"Category", "category", 110, 12, 2 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::exe>{ L"EXE", "exe", 360, 0, 10 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::product>{ L"Product", "product", 160, 16, 1 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::company>{ L"Company", "company", 160, 16, 1 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::version>{ L"Version", "version", 100, 14, 1 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::sha256>{ L"SHA-256", "sha256", 200, 16, 0 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::signer>{ L"Signer", "signer", 160, 16, 0 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::signerIssuer>{ L"Issuer", "signerIssuer", 160, 16, 0 },
+    ColumnDef<ColType::Flag, bool, &CamRow::activeNow>{ L"Active", "active", 70, 6, 9 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::policy>{ L"Policy", "policy", 80, 9, 4 },
+    ColumnDef<ColType::Time, ULONGLONG, &CamRow::startFt>{ L"Last Start", "lastStart", 140, 19, 8 },
+    ColumnDef<ColType::Time, ULONGLONG, &CamRow::stopFt>{ L"Last Stop", "lastStop", 140, 19, 7 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::capability>{ L"Capability", "capability", 100, 12, 6 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::user>{ L"User", "user", 100, 12, 5 },
+    ColumnDef<ColType::Text, std::wstring, &CamRow::container>{ L"Container", "container", 140, 16, 5 });
+
+// Positions in kColumns, for code that means a particular column.
+enum { COL_KIND, COL_APP, COL_NAME, COL_CATEGORY, COL_EXE, COL_PRODUCT, COL_COMPANY, COL_VERSION, COL_SHA256, COL_SIGNER, COL_ISSUER, COL_ACTIVE, COL_POLICY, COL_START, COL_STOP, COL_CAPABILITY, COL_USER, COL_CONTAINER, COL_COUNT };
+
+constexpr size_t kColumnCount = std::tuple_size<std::remove_const_t<decltype(kColumns)>>::value;
+static_assert(kColumnCount == COL_COUNT, "column enum out of step with kColumns");
+
+template <size_t C>
+using ColumnAt = std::tuple_element_t<C, std::remove_const_t<decltype(kColumns)>>;
+
+// The text columns that identify a row, most selective first.
+using IdentityColumns = std::index_sequence<COL_APP, COL_EXE, COL_KIND, COL_CAPABILITY, COL_USER, COL_CONTAINER>;
+
+// The same without the capability: one app, whatever it used.
+using AppColumns = std::index_sequence<COL_APP, COL_EXE, COL_KIND, COL_USER, COL_CONTAINER>;
+
+// Calls f(std::integral_constant<size_t, C>) for every column, unrolled.
+template <typename F, size_t... I>
+static void ForEachColumn(F&& f, std::index_sequence<I...>) {
+    (f(std::integral_constant<size_t, I>()), ...);
+}
+
+template <typename F>
+static void ForEachColumn(F&& f) {
+    ForEachColumn(f, std::make_index_sequence<kColumnCount>());
+}
+
+// Sort key: the first four folded characters of text, the value otherwise.
+template <size_t C>
+static ULONGLONG Column_Key(const CamRow& r) {
+    using Col = ColumnAt<C>;
+    if constexpr (Col::type == ColType::Text) return FoldedPrefix(r.*Col::field);
+    else return static_cast<ULONGLONG>(r.*Col::field);
+}
+
+// Order of two rows whose keys for this column are equal.
+template <size_t C>
+static int Column_Compare(const CamRow& a, const CamRow& b) {
+    using Col = ColumnAt<C>;
+    if constexpr (Col::type == ColType::Text) return CompareFolded(a.*Col::field, b.*Col::field, 4);
+    else return 0; // the key is the whole value
+}
+
+// Display text; times are formatted into scratch.
+template <size_t C>
+static const wchar_t* Column_Text(const CamRow& r, std::wstring& scratch) {
+    using Col = ColumnAt<C>;
+    if constexpr (Col::type == ColType::Text) {
+        return (r.*Col::field).c_str();
+    }
+    else if constexpr (Col::type == ColType::Flag) {
+        return r.*Col::field ? L"Yes" : L"No";
+    }
+    else {
+        scratch = FtToLocalString(r.*Col::field);
+        return scratch.c_str();
+    }
+}
+
+struct ColumnInfo {
+    const wchar_t* title;
+    const char* name;
+    int listWidth;
+    int watchWidth;
+    int watchKeep;
+    ColType type;
+    int (*compare)(const CamRow&, const CamRow&);
+    const wchar_t* (*text)(const CamRow&, std::wstring&);
+};
+
+template <size_t... I>
+constexpr std::array<ColumnInfo, sizeof...(I)> MakeColumnInfo(std::index_sequence<I...>) {
+    return { { ColumnInfo{ std::get<I>(kColumns).title, std::get<I>(kColumns).name,
+        std::get<I>(kColumns).listWidth, std::get<I>(kColumns).watchWidth, std::get<I>(kColumns).watchKeep,
+        ColumnAt<I>::type,
+        &Column_Compare<I>, &Column_Text<I> }... } };
+}
+
+// Per-column data and entry points, indexed by column number at run time.
+constexpr std::array<ColumnInfo, kColumnCount> kColumnInfo = MakeColumnInfo(std::make_index_sequence<kColumnCount>());
+
+// ConsentStore capabilities known at build time. Metrics report each of them
+// (zero when unused) so their series exist from the first scrape; any other
+// capability found in the store is still scanned and shown.
+constexpr const wchar_t* kCapabilities[] = {
+    L"webcam", L"microphone", L"location", L"contacts", L"appointments", L"phoneCall",
+    L"phoneCallHistory", L"email", L"chat", L"radios", L"userDataTasks",
+    L"userNotificationListener", L"userAccountInformation", L"appDiagnostics",
+    L"documentsLibrary", L"picturesLibrary", L"videosLibrary", L"broadFileSystemAccess",
+    L"activity", L"bluetoothSync", L"humanInterfaceDevice", L"gazeInput", L"cellularData",
+    L"wifiData", L"graphicsCaptureProgrammatic", L"graphicsCaptureWithoutBorder",
+};
+
+// Active rows first, then by last start, newest first.
+static void SortRows(std::vector<CamRow>& out) {
+    std::sort(out.begin(), out.end(), [](const CamRow& a, const CamRow& b) {
+        if (a.activeNow != b.activeNow) return a.activeNow > b.activeNow;
+        return a.startFt > b.startFt;
+        });
+}
+
+// ---------------------- Known Apps --------------------------
+// Display name and category for well-known camera and microphone users,
+// keyed by exe leaf name (Windows and Linux) or by package name, the family
+// name without its publisher id. The table is hashed at compile time: a seed
+// is searched for under which every key lands in its own slot, so a lookup
+// is one hash, one slot read and one compare, with nothing built at startup.
+// Keys are lowercase ASCII and matched case-insensitively.
+struct KnownApp {
+    std::wstring_view key;
+    const wchar_t* name;
+    const wchar_t* category;
+};
+
+constexpr KnownApp kKnownApps[] = {
+    // Video calls and messaging
+    { L"zoom.exe", L"Zoom", L"Video calls" },
+    { L"zoom", L"Zoom", L"Video calls" },
+    { L"ms-teams.exe", L"Microsoft Teams", L"Video calls" },
+    { L"teams.exe", L"Microsoft Teams (classic)", L"Video calls" },
+    { L"msteams", L"Microsoft Teams", L"Video calls" },
+    { L"microsoftteams", L"Microsoft Teams (classic)", L"Video calls" },
+    { L"ciscocollabhost.exe", L"Webex", L"Video calls" },
+    { L"atmgr.exe", L"Webex Meetings", L"Video calls" },
+    { L"g2mcomm.exe", L"GoTo Meeting", L"Video calls" },
+    { L"skype.exe", L"Skype", L"Video calls" },
+    { L"microsoft.skypeapp", L"Skype", L"Video calls" },
+    { L"slack.exe", L"Slack", L"Messaging" },
+    { L"slack", L"Slack", L"Messaging" },
+    { L"discord.exe", L"Discord", L"Messaging" },
+    { L"discord", L"Discord", L"Messaging" },
+    { L"whatsapp.exe", L"WhatsApp", L"Messaging" },
+    { L"5319275a.whatsappdesktop", L"WhatsApp", L"Messaging" },
+    { L"telegram.exe", L"Telegram", L"Messaging" },
+    { L"signal.exe", L"Signal", L"Messaging" },
+    { L"microsoft.yourphone", L"Phone Link", L"Messaging" },
+    // Browsers
+    { L"chrome.exe", L"Google Chrome", L"Browser" },
+    { L"chrome", L"Google Chrome", L"Browser" },
+    { L"chromium", L"Chromium", L"Browser" },
+    { L"msedge.exe", L"Microsoft Edge", L"Browser" },
+    { L"firefox.exe", L"Firefox", L"Browser" },
+    { L"firefox", L"Firefox", L"Browser" },
+    { L"brave.exe", L"Brave", L"Browser" },
+    { L"opera.exe", L"Opera", L"Browser" },
+    // Streaming, recording and camera effects
+    { L"obs64.exe", L"OBS Studio", L"Streaming" },
+    { L"obs32.exe", L"OBS Studio", L"Streaming" },
+    { L"obs", L"OBS Studio", L"Streaming" },
+    { L"streamlabs obs.exe", L"Streamlabs", L"Streaming" },
+    { L"xsplit.core.exe", L"XSplit", L"Streaming" },
+    { L"microsoft.xboxgamingoverlay", L"Xbox Game Bar", L"Recording" },
+    { L"microsoft.windowssoundrecorder", L"Sound Recorder", L"Recording" },
+    { L"clipchamp.clipchamp", L"Clipchamp", L"Recording" },
+    { L"nvidia broadcast.exe", L"NVIDIA Broadcast", L"Camera effects" },
+    { L"manycam.exe", L"ManyCam", L"Camera effects" },
+    { L"snapcamera.exe", L"Snap Camera", L"Camera effects" },
+    // Camera apps and media players
+    { L"microsoft.windowscamera", L"Camera", L"Camera" },
+    { L"windowscamera.exe", L"Camera", L"Camera" },
+    { L"cheese", L"Cheese", L"Camera" },
+    { L"snapshot", L"Snapshot", L"Camera" },
+    { L"guvcview", L"guvcview", L"Camera" },
+    { L"kamoso", L"Kamoso", L"Camera" },
+    { L"vlc.exe", L"VLC", L"Media player" },
+    { L"vlc", L"VLC", L"Media player" },
+    // Linux sound servers (they hold the capture node for every recorder)
+    { L"pipewire", L"PipeWire", L"Sound server" },
+    { L"wireplumber", L"WirePlumber", L"Sound server" },
+    { L"pulseaudio", L"PulseAudio", L"Sound server" },
+};
+
+constexpr size_t kKnownAppSlots = 512; // power of two; ~10x the entries keeps the seed search short
+constexpr uint8_t kNoKnownApp = 0xFF;
+static_assert(std::size(kKnownApps) < kNoKnownApp, "slot entries are 8-bit");
+
+// FNV-1a over the ASCII-folded key, seeded, with a final mix.
+constexpr uint32_t KnownApp_Hash(std::wstring_view key, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (wchar_t c : key) {
+        if (c >= L'A' && c <= L'Z') c = static_cast<wchar_t>(c + 32);
+        h = (h ^ static_cast<uint32_t>(c)) * 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    return h;
+}
+
+struct KnownAppTable {
+    uint32_t seed;
+    uint8_t  slot[kKnownAppSlots]; // kKnownApps index, or kNoKnownApp
+};
+
+constexpr KnownAppTable KnownApp_Build() {
+    for (uint32_t seed = 0; seed < 10000; ++seed) {
+        KnownAppTable t{ seed, {} };
+        for (uint8_t& s : t.slot) s = kNoKnownApp;
+        bool ok = true;
+        for (size_t i = 0; ok && i < std::size(kKnownApps); ++i) {
+            uint8_t& s = t.slot[KnownApp_Hash(kKnownApps[i].key, seed) & (kKnownAppSlots - 1)];
+            ok = s == kNoKnownApp;
+            s = static_cast<uint8_t>(i);
+        }
+        if (ok) return t;
+    }
+    return KnownAppTable{ ~0u, {} };
+}
+
+constexpr bool KnownApp_KeysLowercase() {
+    for (const KnownApp& a : kKnownApps) {
+        for (wchar_t c : a.key) {
+            if (c >= 0x80 || (c >= L'A' && c <= L'Z')) return false;
+        }
+    }
+    return true;
+}
+
+constexpr KnownAppTable kKnownAppTable = KnownApp_Build();
+static_assert(kKnownAppTable.seed != ~0u, "no collision-free seed (duplicate key?); grow kKnownAppSlots");
+static_assert(KnownApp_KeysLowercase(), "kKnownApps keys must be lowercase ASCII");
+
+static const KnownApp* KnownApp_Find(std::wstring_view key) {
+    const uint8_t i = kKnownAppTable.slot[KnownApp_Hash(key, kKnownAppTable.seed) & (kKnownAppSlots - 1)];
+    if (i == kNoKnownApp || kKnownApps[i].key.size() != key.size()) return nullptr;
+    for (size_t k = 0; k < key.size(); ++k) {
+        wchar_t c = key[k];
+        if (c >= L'A' && c <= L'Z') c = static_cast<wchar_t>(c + 32);
+        if (c != kKnownApps[i].key[k]) return nullptr;
+    }
+    return &kKnownApps[i];
+}
+
+// Fills r.name and r.category from the catalog: desktop rows by exe leaf
+// name (r.app), packaged rows by package name.
+static void KnownApp_Apply(CamRow& r) {
+    std::wstring_view key = r.app;
+    if (r.kind == L"Packaged") key = key.substr(0, key.find(L'_'));
+    const KnownApp* a = KnownApp_Find(key);
+    r.name = a ? a->name : L"";
+    r.category = a ? a->category : L"";
+}
+
+#ifdef _WIN32
+
+// Registry opens, enumerations and value reads made by the current scan
+// (reported by the metrics endpoint)
+static std::atomic<ULONGLONG> g_regCalls{ 0 };
+
+static bool RegGetQword(HKEY hKey, const wchar_t* valueName, ULONGLONG& out) {
+    ++g_regCalls;
+    DWORD type = 0;
+    ULONGLONG val = 0;
+    DWORD cb = sizeof(val);
+    LONG r = RegGetValueW(hKey, nullptr, valueName, RRF_RT_QWORD, &type, &val, &cb);
+    if (r == ERROR_SUCCESS) { out = val; return true; }
+    return false;
+}
+
+// Registry access used by the scanner. LiveReg reads loaded hives through the
+// normal API; OfflineReg reads an unloaded NTUSER.DAT through offreg.dll, which
+// parses the file itself and so needs neither RegLoadKey nor the backup
+// privilege. Both expose the same calls so one walk serves both.
+struct LiveReg {
+    typedef HKEY Key;
+    static bool Open(Key parent, const wchar_t* sub, Key& out) {
+        ++g_regCalls;
+        return RegOpenKeyExW(parent, sub, 0, KEY_READ, &out) == ERROR_SUCCESS;
+    }
+    static LONG Enum(Key k, DWORD index, wchar_t* name, DWORD& nameLen) {
+        ++g_regCalls;
+        return RegEnumKeyExW(k, index, name, &nameLen, nullptr, nullptr, nullptr, nullptr);
+    }
+    static bool Qword(Key k, const wchar_t* valueName, ULONGLONG& out) { return RegGetQword(k, valueName, out); }
+    static void Close(Key k) { RegCloseKey(k); }
+};
+
+// offreg.dll ships with Windows but has no import library in the SDK, so it is
+// bound on first use. Without it, unloaded profiles are skipped.
+struct OfflineReg {
+    typedef void* Key; // ORHKEY
+    typedef DWORD(WINAPI* OpenHiveFn)(LPCWSTR, Key*);
+    typedef DWORD(WINAPI* CloseFn)(Key);
+    typedef DWORD(WINAPI* OpenKeyFn)(Key, LPCWSTR, Key*);
+    typedef DWORD(WINAPI* EnumKeyFn)(Key, DWORD, LPWSTR, LPDWORD, LPWSTR, LPDWORD, FILETIME*);
+    typedef DWORD(WINAPI* GetValueFn)(Key, LPCWSTR, LPCWSTR, LPDWORD, void*, LPDWORD);
+
+    struct Api {
+        OpenHiveFn openHive = nullptr;
+        CloseFn closeHive = nullptr;
+        OpenKeyFn openKey = nullptr;
+        CloseFn closeKey = nullptr;
+        EnumKeyFn enumKey = nullptr;
+        GetValueFn getValue = nullptr;
+    };
+
+    static const Api* Bind() {
+        static const Api api = []() {
+            Api a;
+            HMODULE dll = LoadLibraryW(L"offreg.dll");
+            if (!dll) return a;
+            a.openHive = reinterpret_cast<OpenHiveFn>(GetProcAddress(dll, "OROpenHive"));
+            a.closeHive = reinterpret_cast<CloseFn>(GetProcAddress(dll, "ORCloseHive"));
+            a.openKey = reinterpret_cast<OpenKeyFn>(GetProcAddress(dll, "OROpenKey"));
+            a.closeKey = reinterpret_cast<CloseFn>(GetProcAddress(dll, "ORCloseKey"));
+            a.enumKey = reinterpret_cast<EnumKeyFn>(GetProcAddress(dll, "OREnumKey"));
+            a.getValue = reinterpret_cast<GetValueFn>(GetProcAddress(dll, "ORGetValue"));
+            if (!a.openHive || !a.closeHive || !a.openKey || !a.closeKey || !a.enumKey || !a.getValue) {
+                FreeLibrary(dll);
+                a = Api();
+            }
+            return a;
+        }();
+        return api.openHive ? &api : nullptr;
+    }
+
+    static bool Open(Key parent, const wchar_t* sub, Key& out) {
+        ++g_regCalls;
+        return Bind()->openKey(parent, sub, &out) == ERROR_SUCCESS;
+    }
+    static LONG Enum(Key k, DWORD index, wchar_t* name, DWORD& nameLen) {
+        ++g_regCalls;
+        return static_cast<LONG>(Bind()->enumKey(k, index, name, &nameLen, nullptr, nullptr, nullptr));
+    }
+    static bool Qword(Key k, const wchar_t* valueName, ULONGLONG& out) {
+        ++g_regCalls;
+        DWORD type = 0;
+        ULONGLONG val = 0;
+        DWORD cb = sizeof(val);
+        if (Bind()->getValue(k, nullptr, valueName, &type, &val, &cb) != ERROR_SUCCESS) return false;
+        if (type != REG_QWORD || cb != sizeof(val)) return false;
+        out = val;
+        return true;
+    }
+    static void Close(Key k) { Bind()->closeKey(k); }
+};
+
+// Appends the rows of one capability subtree (hBase = ConsentStore\<capability>).
+template <typename Reg>
+static void LoadCapability(typename Reg::Key hBase, const std::wstring& capability,
+    const std::wstring& user, std::vector<CamRow>& out) {
+    DWORD index = 0;
+    wchar_t name[512];
+    DWORD nameLen;
+    while (true) {
+        nameLen = static_cast<DWORD>(std::size(name));
+        LONG rr = Reg::Enum(hBase, index++, name, nameLen);
+        if (rr == ERROR_NO_MORE_ITEMS) break;
+        if (rr != ERROR_SUCCESS) continue;
+
+        std::wstring subkey = name;
+        if (_wcsicmp(subkey.c_str(), L"NonPackaged") == 0) {
+            // Desktop apps
+            typename Reg::Key hNp = nullptr;
+            if (Reg::Open(hBase, L"NonPackaged", hNp)) {
+                DWORD idx2 = 0;
+                wchar_t n2[1024]; DWORD n2len;
+                while (true) {
+                    n2len = static_cast<DWORD>(std::size(n2));
+                    LONG r2 = Reg::Enum(hNp, idx2++, n2, n2len);
+                    if (r2 == ERROR_NO_MORE_ITEMS) break;
+                    if (r2 != ERROR_SUCCESS) continue;
+
+                    typename Reg::Key hItem = nullptr;
+                    if (Reg::Open(hNp, n2, hItem)) {
+                        ULONGLONG start = 0, stop = 0;
+                        Reg::Qword(hItem, L"LastUsedTimeStart", start);
+                        Reg::Qword(hItem, L"LastUsedTimeStop", stop);
+                        Reg::Close(hItem);
+
+                        std::wstring raw = n2;
+                        std::wstring exe = ReplaceAll(raw, L'#', L'\\');
+                        CamRow row;
+                        row.kind = L"Desktop";
+                        row.capability = capability;
+                        row.user = user;
+                        row.exe = exe;
+                        row.app = LeafName(exe);
+                        KnownApp_Apply(row);
+                        row.startFt = start;
+                        row.stopFt = stop;
+                        row.activeNow = (start != 0) && (stop == 0);
+                        out.push_back(std::move(row));
+                    }
+                }
+                Reg::Close(hNp);
+            }
+        }
+        else {
+            // Packaged apps
+            typename Reg::Key hChild = nullptr;
+            if (Reg::Open(hBase, subkey.c_str(), hChild)) {
+                ULONGLONG start = 0, stop = 0;
+                Reg::Qword(hChild, L"LastUsedTimeStart", start);
+                Reg::Qword(hChild, L"LastUsedTimeStop", stop);
+                Reg::Close(hChild);
+
+                CamRow row;
+                row.kind = L"Packaged";
+                row.capability = capability;
+                row.user = user;
+                row.app = subkey;
+                row.exe = L"";
+                KnownApp_Apply(row);
+                row.startFt = start;
+                row.stopFt = stop;
+                row.activeNow = (start != 0) && (stop == 0);
+                out.push_back(std::move(row));
+            }
+        }
+    }
+}
+
+// Capability subtrees are scanned on worker threads once there are enough of
+// them to pay for the threads.
+const size_t kScanParallelMin = 4;
+const unsigned kScanThreadsMax = 8;
+
+// Appends every capability under an open ConsentStore key. maxThreads = 1
+// keeps the walk on the calling thread (the all-users scan already runs one
+// hive per thread).
+template <typename Reg>
+static void LoadStore(typename Reg::Key hStore, const std::wstring& user, std::vector<CamRow>& out,
+    unsigned maxThreads) {
+    std::vector<std::wstring> caps;
+    wchar_t name[256];
+    for (DWORD index = 0;; ++index) {
+        DWORD nameLen = static_cast<DWORD>(std::size(name));
+        LONG rr = Reg::Enum(hStore, index, name, nameLen);
+        if (rr == ERROR_NO_MORE_ITEMS) break;
+        if (rr == ERROR_SUCCESS) caps.emplace_back(name, nameLen);
+    }
+
+    std::vector<std::vector<CamRow>> parts(caps.size());
+    std::atomic<size_t> nextCap{ 0 };
+    auto worker = [&]() {
+        for (size_t i; (i = nextCap++) < caps.size();) {
+            typename Reg::Key hCap = nullptr;
+            if (!Reg::Open(hStore, caps[i].c_str(), hCap)) continue;
+            LoadCapability<Reg>(hCap, caps[i], user, parts[i]);
+            Reg::Close(hCap);
+        }
+    };
+    unsigned threads = std::min<unsigned>(std::max(1u, std::thread::hardware_concurrency()), maxThreads);
+    if (caps.size() < kScanParallelMin) threads = 1;
+    threads = std::min<unsigned>(threads, static_cast<unsigned>(caps.size()));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    size_t total = out.size();
+    for (const auto& p : parts) total += p.size();
+    out.reserve(total);
+    for (auto& p : parts) std::move(p.begin(), p.end(), std::back_inserter(out));
+}
+
+// Opens ConsentStore once and reads every capability under it.
+static void LoadConsentStore(std::vector<CamRow>& out) {
+    out.clear();
+    g_regCalls = 0;
+
+    HKEY hStore = nullptr;
+    if (!LiveReg::Open(HKEY_CURRENT_USER, REG_CONSENT_STORE, hStore)) return;
+    LoadStore<LiveReg>(hStore, std::wstring(), out, kScanThreadsMax);
+    RegCloseKey(hStore);
+    SortRows(out);
+}
+
+// ---- All users ----
+// Every profile on the machine: the hives loaded under HKEY_USERS (signed-in
+// users and services running as them) plus, from ProfileList, the NTUSER.DAT
+// of everyone else. Reading other users' hives needs an elevated process;
+// hives that cannot be opened are skipped.
+const wchar_t* const REG_PROFILE_LIST =
+L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\ProfileList";
+
+// Hives are scanned one per thread; the work is mostly waiting on the disk
+// (offline hives are read whole), so there are more threads than cores.
+const unsigned kHiveThreadsMax = 32;
+
+struct UserHive {
+    std::wstring sid;
+    std::wstring user;     // profile folder name, or the SID when unknown
+    std::wstring hivePath; // NTUSER.DAT; empty for hives loaded under HKU
+    ULONGLONG    bytes{ 0 }; // size of hivePath, the cost estimate for scheduling
+};
+
+static bool IsServiceSid(const std::wstring& sid) {
+    return sid == L".DEFAULT" || sid == L"S-1-5-18" || sid == L"S-1-5-19" || sid == L"S-1-5-20";
+}
+
+static void ListUserHives(std::vector<UserHive>& hives) {
+    hives.clear();
+    wchar_t name[256];
+
+    std::vector<std::wstring> loaded;
+    for (DWORD index = 0;; ++index) {
+        DWORD nameLen = static_cast<DWORD>(std::size(name));
+        LONG rr = LiveReg::Enum(HKEY_USERS, index, name, nameLen);
+        if (rr == ERROR_NO_MORE_ITEMS) break;
+        if (rr != ERROR_SUCCESS) continue;
+        std::wstring sid(name, nameLen);
+        if (IsServiceSid(sid)) continue;
+        if (sid.size() > 8 && _wcsicmp(sid.c_str() + sid.size() - 8, L"_Classes") == 0) continue;
+        loaded.push_back(std::move(sid));
+    }
+
+    HKEY hList = nullptr;
+    std::unordered_map<std::wstring, std::wstring> profileDir;
+    if (LiveReg::Open(HKEY_LOCAL_MACHINE, REG_PROFILE_LIST, hList)) {
+        for (DWORD index = 0;; ++index) {
+            DWORD nameLen = static_cast<DWORD>(std::size(name));
+            LONG rr = LiveReg::Enum(hList, index, name, nameLen);
+            if (rr == ERROR_NO_MORE_ITEMS) break;
+            if (rr != ERROR_SUCCESS) continue;
+            std::wstring sid(name, nameLen);
+            if (IsServiceSid(sid)) continue;
+            wchar_t path[MAX_PATH];
+            DWORD cb = sizeof(path);
+            ++g_regCalls;
+            // RRF_RT_REG_SZ also accepts REG_EXPAND_SZ, returned expanded.
+            if (RegGetValueW(hList, sid.c_str(), L"ProfileImagePath", RRF_RT_REG_SZ, nullptr, path, &cb) == ERROR_SUCCESS) {
+                profileDir[sid] = path;
+            }
+        }
+        RegCloseKey(hList);
+    }
+
+    for (auto& sid : loaded) {
+        UserHive h;
+        auto it = profileDir.find(sid);
+        h.user = it != profileDir.end() ? LeafName(it->second) : sid;
+        if (it != profileDir.end()) profileDir.erase(it);
+        h.sid = std::move(sid);
+        hives.push_back(std::move(h));
+    }
+    if (!OfflineReg::Bind()) return;
+    for (auto& p : profileDir) {
+        UserHive h;
+        h.sid = p.first;
+        h.user = LeafName(p.second);
+        h.hivePath = p.second + L"\\NTUSER.DAT";
+        WIN32_FILE_ATTRIBUTE_DATA fa{};
+        if (!GetFileAttributesExW(h.hivePath.c_str(), GetFileExInfoStandard, &fa)) continue;
+        h.bytes = (static_cast<ULONGLONG>(fa.nFileSizeHigh) << 32) | fa.nFileSizeLow;
+        hives.push_back(std::move(h));
+    }
+}
+
+// Reads one user's ConsentStore, from HKU or from the hive file.
+static void LoadUserHive(const UserHive& h, std::vector<CamRow>& out) {
+    if (h.hivePath.empty()) {
+        HKEY hStore = nullptr;
+        std::wstring path = h.sid + L"\\" + REG_CONSENT_STORE;
+        if (!LiveReg::Open(HKEY_USERS, path.c_str(), hStore)) return;
+        LoadStore<LiveReg>(hStore, h.user, out, 1);
+        RegCloseKey(hStore);
+        return;
+    }
+    const OfflineReg::Api* api = OfflineReg::Bind();
+    OfflineReg::Key hive = nullptr;
+    ++g_regCalls;
+    if (api->openHive(h.hivePath.c_str(), &hive) != ERROR_SUCCESS) return; // in use or access denied
+    OfflineReg::Key hStore = nullptr;
+    if (OfflineReg::Open(hive, REG_CONSENT_STORE, hStore)) {
+        LoadStore<OfflineReg>(hStore, h.user, out, 1);
+        OfflineReg::Close(hStore);
+    }
+    api->closeHive(hive);
+}
+
+// Scans every user's ConsentStore into one user-tagged list. Hives are handed
+// out largest first, so the biggest ones start immediately and the small ones
+// fill in around them: with enough threads the scan takes about as long as
+// its slowest hive. Loaded hives are already in memory and go last.
+static void LoadAllUsers(std::vector<CamRow>& out) {
+    out.clear();
+    g_regCalls = 0;
+
+    std::vector<UserHive> hives;
+    ListUserHives(hives);
+    std::stable_sort(hives.begin(), hives.end(), [](const UserHive& a, const UserHive& b) {
+        return a.bytes > b.bytes;
+        });
+
+    std::vector<std::vector<CamRow>> parts(hives.size());
+    std::atomic<size_t> nextHive{ 0 };
+    auto worker = [&]() {
+        for (size_t i; (i = nextHive++) < hives.size();) LoadUserHive(hives[i], parts[i]);
+    };
+    unsigned threads = std::min<unsigned>(static_cast<unsigned>(hives.size()), kHiveThreadsMax);
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    size_t total = 0;
+    for (const auto& p : parts) total += p.size();
+    out.reserve(total);
+    for (auto& p : parts) std::move(p.begin(), p.end(), std::back_inserter(out));
+    SortRows(out);
+}
+
+#endif // _WIN32
+
+#ifdef __linux__
+// ---------------------- Linux Device Holders ----------------
+// The Linux source. A process using a camera holds an open fd on a V4L2 node
+// (/dev/videoN), one recording sound an ALSA capture node (/dev/snd/pcmC0D0c),
+// so every /proc/<pid>/fd is listed with getdents64 and its
+// entries resolved with readlinkat, all relative to directory fds: nothing
+// builds a path string per process or per fd. Rows are kept per capability
+// and executable with the meaning the ConsentStore values have: Last Start is
+// when a holder was first seen, Last Stop when the last one went away.
+// --proc-root points the walk at another tree (a fake one, or a container's),
+// --dev-root the device nodes at another directory.
+static std::string g_procRoot = "/proc";
+static std::string g_devRoot = "/dev";
+
+struct ProcRow {
+    CamRow row;
+    ULONGLONG seen{ 0 }; // last scan that found a holder
+};
+
+// What the last scan found in one process.
+struct ProcEntry {
+    ULONGLONG startTicks{ 0 }; // tells a reused PID apart
+    uint32_t fdCount{ 0 };
+    ULONGLONG seen{ 0 };       // last scan that listed the process
+    std::vector<const wchar_t*> caps; // capabilities it holds devices for
+    bool cgroupRead{ false };  // container is known (read when it first holds a device)
+    uint64_t cgroup{ 0 };      // inode it was cached under, 0 if none
+    std::wstring container;
+};
+
+// Who a process is: resolved from exe (or cmdline) the first time it is seen
+// holding a device and reused for as long as it lives. Keyed by pid and start
+// time, so a reused PID is a different entry; the cache is bounded, least
+// recently used first out, and entries go as soon as their process exits.
+const size_t kIdentityCacheSize = 512;
+
+struct ProcIdentity {
+    ULONGLONG key;     // Proc_IdentityKey(pid, start ticks)
+    ULONGLONG startFt; // process start, FILETIME
+    std::wstring exe, app;
+};
+
+struct IdentityCache {
+    std::list<ProcIdentity> lru; // most recently used first
+    std::unordered_map<ULONGLONG, std::list<ProcIdentity>::iterator> byKey;
+};
+
+// PIDs stay below 2^22 and start times (clock ticks since boot) below 2^40,
+// so the two fit one key without overlapping.
+static ULONGLONG Proc_IdentityKey(int pid, ULONGLONG startTicks) {
+    return (static_cast<ULONGLONG>(pid) << 40) | (startTicks & ((1ULL << 40) - 1));
+}
+
+struct ProcRows {
+    std::unordered_map<std::wstring, ProcRow> byKey; // capability|exe|app|container -> row
+    std::unordered_map<int, ProcEntry> procs;        // pid -> last look at its fds
+    std::unordered_map<uint64_t, std::wstring> cgroups; // cgroup inode -> container
+    IdentityCache identities;
+    std::vector<int> holderPids; // processes holding a device at the last scan
+    ULONGLONG scans{ 0 };
+};
+static ProcRows g_procRows;
+
+// getdents64 record header; the NUL-terminated name follows at kDirentName.
+struct LinuxDirent64 {
+    uint64_t ino;
+    int64_t  off;
+    uint16_t reclen;
+    uint8_t  type;
+};
+const size_t kDirentName = 19;
+
+// Calls f(name) for every entry of the directory open as dirFd except . and ..
+template <typename F>
+static void Proc_ForEachEntry(int dirFd, F&& f) {
+    alignas(8) char buf[16384];
+    for (;;) {
+        long n = syscall(SYS_getdents64, dirFd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (long off = 0; off < n;) {
+            const LinuxDirent64* d = reinterpret_cast<const LinuxDirent64*>(buf + off);
+            const char* name = buf + off + kDirentName;
+            off += d->reclen;
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+            f(name);
+        }
+    }
+}
+
+static bool Proc_IsPid(const char* name) {
+    if (*name == 0) return false;
+    for (; *name; ++name) {
+        if (*name < '0' || *name > '9') return false;
+    }
+    return true;
+}
+
+// Reads the start of a proc file relative to dirFd into buf, NUL-terminated.
+static size_t Proc_ReadAt(int dirFd, const char* name, char* buf, size_t size) {
+    int fd = openat(dirFd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    n = std::max<ssize_t>(n, 0);
+    buf[n] = 0;
+    return static_cast<size_t>(n);
+}
+
+// Boot time as FILETIME, from the btime line of <proc>/stat, or 0 if it
+// cannot be found. The file is read whole: on machines with many CPUs the
+// cpu and intr lines push btime well past any fixed-size buffer.
+static ULONGLONG Proc_BootFt(int procFd) {
+    int fd = openat(procFd, "stat", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    std::string text;
+    char buf[8192];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) text.append(buf, static_cast<size_t>(n));
+    close(fd);
+    size_t p = text.find("\nbtime ");
+    if (p == std::string::npos) return 0;
+    return 116444736000000000ULL + strtoull(text.c_str() + p + 7, nullptr, 10) * kTicksPerSecond;
+}
+
+// Start time (clock ticks since boot, field 22) and command name of a
+// process, from its stat line. comm may itself contain spaces and ')'.
+static bool Proc_ParseStat(const char* stat, ULONGLONG& startTicks, std::string& comm) {
+    const char* open = strchr(stat, '(');
+    const char* close = strrchr(stat, ')');
+    if (!open || !close || close < open) return false;
+    comm.assign(open + 1, close);
+    const char* p = close + 1; // the space before field 3
+    for (int field = 3; field < 22; ++field) {
+        p = strchr(p + 1, ' ');
+        if (!p) return false;
+    }
+    startTicks = strtoull(p + 1, nullptr, 10);
+    return true;
+}
+
+// Device nodes, relative to g_devRoot, and the capability holding one open
+// means. Patterns are literal except '#', one or more digits. Every fd is
+// classified against this table in the same walk.
+struct DeviceMatcher {
+    const char* pattern;
+    const wchar_t* capability;
+};
+
+constexpr DeviceMatcher kDeviceMatchers[] = {
+    { "video#", L"webcam" },             // V4L2 capture
+    { "snd/pcmC#D#c", L"microphone" },   // ALSA PCM capture (card, device)
+};
+
+static bool Proc_MatchNode(const char* pattern, const char* node) {
+    while (*pattern) {
+        if (*pattern == '#') {
+            if (*node < '0' || *node > '9') return false;
+            while (*node >= '0' && *node <= '9') ++node;
+            ++pattern;
+        }
+        else if (*pattern++ != *node++) {
+            return false;
+        }
+    }
+    return *node == 0;
+}
+
+// The capability a device node stands for, or nullptr.
+static const wchar_t* Proc_DeviceCapability(const char* node) {
+    for (const DeviceMatcher& m : kDeviceMatchers) {
+        if (Proc_MatchNode(m.pattern, node)) return m.capability;
+    }
+    return nullptr;
+}
+
+// A process found holding a device.
+struct ProcHolder {
+    int pid;
+    ULONGLONG startFt;
+    std::wstring exe, app, container;
+    const wchar_t* capability;
+};
+
+// Appends to caps each capability the process (pidFd = /proc/<pid>) has a
+// device open for. devPrefix is g_devRoot with a trailing '/'.
+static void Proc_ScanFds(int pidFd, const std::string& devPrefix, std::vector<const wchar_t*>& caps) {
+    int fdDir = openat(pidFd, "fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fdDir < 0) return; // exited, or another user's without privileges
+    char target[4096];
+    Proc_ForEachEntry(fdDir, [&](const char* fd) {
+        ssize_t n = readlinkat(fdDir, fd, target, sizeof(target) - 1);
+        if (n <= static_cast<ssize_t>(devPrefix.size()) || memcmp(target, devPrefix.data(), devPrefix.size()) != 0) {
+            return; // sockets, pipes, files
+        }
+        target[n] = 0;
+        const wchar_t* cap = Proc_DeviceCapability(target + devPrefix.size());
+        if (cap && std::find(caps.begin(), caps.end(), cap) == caps.end()) caps.push_back(cap);
+    });
+    close(fdDir);
+}
+
+// Number of open fds. procfs reports it as the size of /proc/<pid>/fd (Linux
+// 6.2+); older kernels, and proc trees on other filesystems, get the entries
+// counted instead.
+static uint32_t Proc_FdCount(int pidFd, bool procfs) {
+    struct stat st {};
+    if (procfs && fstatat(pidFd, "fd", &st, 0) == 0 && st.st_size > 0) return static_cast<uint32_t>(st.st_size);
+    int fdDir = openat(pidFd, "fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fdDir < 0) return 0;
+    uint32_t n = 0;
+    Proc_ForEachEntry(fdDir, [&](const char*) { ++n; });
+    close(fdDir);
+    return n;
+}
+
+// Executable path and display name of a process. Without access to exe the
+// name comes from argv[0], and from comm (cut to 15 bytes) when there is no
+// command line either (kernel threads).
+static void Proc_Identity(int pidFd, const std::string& comm, std::wstring& exe, std::wstring& app) {
+    char buf[4096];
+    ssize_t n = readlinkat(pidFd, "exe", buf, sizeof(buf) - 1);
+    if (n > 0) {
+        std::string_view path(buf, static_cast<size_t>(n));
+        const std::string_view deleted = " (deleted)";
+        if (path.size() > deleted.size() && path.substr(path.size() - deleted.size()) == deleted) {
+            path.remove_suffix(deleted.size());
+        }
+        AppendWide(exe, path);
+        app = LeafName(exe);
+    }
+    else if (Proc_ReadAt(pidFd, "cmdline", buf, sizeof(buf)) && buf[0]) {
+        std::wstring argv0;
+        AppendWide(argv0, buf); // up to the first NUL
+        app = LeafName(argv0);
+    }
+    else {
+        AppendWide(app, comm);
+    }
+}
+
+// The cached identity of a process generation, resolving it on a miss.
+static const ProcIdentity& Proc_LookupIdentity(IdentityCache& c, int pidFd, int pid, ULONGLONG startTicks,
+    ULONGLONG startFt, const std::string& comm) {
+    const ULONGLONG key = Proc_IdentityKey(pid, startTicks);
+    auto it = c.byKey.find(key);
+    if (it != c.byKey.end()) {
+        c.lru.splice(c.lru.begin(), c.lru, it->second);
+        return c.lru.front();
+    }
+    c.lru.push_front({ key, startFt, std::wstring(), std::wstring() });
+    Proc_Identity(pidFd, comm, c.lru.front().exe, c.lru.front().app);
+    c.byKey[key] = c.lru.begin();
+    if (c.lru.size() > kIdentityCacheSize) {
+        c.byKey.erase(c.lru.back().key);
+        c.lru.pop_back();
+    }
+    return c.lru.front();
+}
+
+// The container, sandbox or systemd unit a cgroup path belongs to, e.g.
+// "docker:4f1c2a9b3d7e", "flatpak:org.gnome.Cheese" or "app-gnome-cheese.scope";
+// empty for the root cgroup. Components are looked at from the leaf up, so a
+// container inside a slice or a pod is found before its parents.
+static std::string Proc_ContainerOf(std::string_view path) {
+    static const std::pair<std::string_view, const char*> kRuntimes[] = {
+        { "docker-", "docker:" }, { "libpod-", "podman:" },
+        { "cri-containerd-", "containerd:" }, { "crio-", "cri-o:" },
+    };
+    static const std::string_view kSuffixes[] = { ".scope", ".service", ".slice" };
+    auto isId = [](std::string_view s) {
+        return s.size() >= 32 && std::all_of(s.begin(), s.end(), [](char c) {
+            return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+            });
+    };
+    // "app-gnome-cheese-4242" -> "app-gnome-cheese": the pid makes every launch a new scope.
+    auto stripInstance = [](std::string_view s) {
+        size_t dash = s.rfind('-');
+        if (dash != std::string_view::npos && dash + 1 < s.size() &&
+            std::all_of(s.begin() + dash + 1, s.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            s = s.substr(0, dash);
+        }
+        return s.substr(0, s.find('@'));
+    };
+
+    std::string unit;
+    for (size_t end = path.size(); end > 0;) {
+        size_t slash = path.rfind('/', end - 1);
+        size_t start = slash == std::string_view::npos ? 0 : slash + 1;
+        std::string_view c = path.substr(start, end - start), base = c, suffix;
+        end = slash == std::string_view::npos ? 0 : slash;
+        for (std::string_view sfx : kSuffixes) {
+            if (base.size() > sfx.size() && base.substr(base.size() - sfx.size()) == sfx) {
+                suffix = sfx;
+                base.remove_suffix(sfx.size());
+                break;
+            }
+        }
+        for (const auto& rt : kRuntimes) {
+            if (base.substr(0, rt.first.size()) == rt.first && isId(base.substr(rt.first.size()))) {
+                return rt.second + std::string(base.substr(rt.first.size(), 12));
+            }
+        }
+        if (suffix.empty() && isId(base)) return "container:" + std::string(base.substr(0, 12)); // cgroupfs driver
+        if (base.substr(0, 12) == "app-flatpak-") return "flatpak:" + std::string(stripInstance(base.substr(12)));
+        if (base.substr(0, 5) == "snap.") return "snap:" + std::string(base.substr(5, base.find('.', 5) - 5));
+        if (unit.empty() && (suffix == ".scope" || suffix == ".service")) {
+            unit = std::string(stripInstance(base)) + std::string(suffix);
+        }
+    }
+    return unit;
+}
+
+// Fills e.container from the unified (v2) line of the process's cgroup file,
+// or the systemd one on v1 (pidFd = /proc/<pid>). Parsed once per cgroup: the
+// result is cached under the cgroup directory's inode.
+static void Proc_Container(int pidFd, ProcRows& pr, ProcEntry& e) {
+    e.cgroupRead = true;
+    char buf[4096];
+    if (!Proc_ReadAt(pidFd, "cgroup", buf, sizeof(buf))) return;
+    std::string_view text(buf), path, mount;
+    for (size_t at = 0; at < text.size();) {
+        size_t nl = std::min(text.find('\n', at), text.size());
+        std::string_view line = text.substr(at, nl - at);
+        at = nl + 1;
+        if (line.substr(0, 3) == "0::") { path = line.substr(3); mount = "/sys/fs/cgroup"; break; }
+        size_t colon = line.find(':');
+        if (colon != std::string_view::npos && line.substr(colon + 1, 13) == "name=systemd:") {
+            path = line.substr(colon + 14);
+            mount = "/sys/fs/cgroup/systemd";
+        }
+    }
+    if (path.empty()) return;
+
+    struct stat st {};
+    std::string dir = std::string(mount) + std::string(path);
+    if (stat(dir.c_str(), &st) != 0) {
+        AppendWide(e.container, Proc_ContainerOf(path)); // not our cgroup tree (e.g. a fake proc root)
+        return;
+    }
+    e.cgroup = static_cast<uint64_t>(st.st_ino);
+    auto ins = pr.cgroups.emplace(e.cgroup, std::wstring());
+    if (ins.second) AppendWide(ins.first->second, Proc_ContainerOf(path));
+    e.container = ins.first->second;
+}
+
+// Drops what is known about a process that has exited.
+static void Proc_Forget(ProcRows& pr, int pid) {
+    auto it = pr.procs.find(pid);
+    if (it == pr.procs.end()) return;
+    auto id = pr.identities.byKey.find(Proc_IdentityKey(pid, it->second.startTicks));
+    if (id != pr.identities.byKey.end()) {
+        pr.identities.lru.erase(id->second);
+        pr.identities.byKey.erase(id);
+    }
+    pr.procs.erase(it);
+}
+
+// What a refresh has to look at in /proc. The timed scan (NONE) walks every
+// process but trusts an unchanged fd count; a device event means some fd did
+// change, possibly without the count moving (dup2 over a descriptor, a close
+// and an open in one burst), so the processes it may concern have all their
+// fds read: the last holders after a close, every process after an open.
+enum { PROC_SCAN_NONE = 0, PROC_SCAN_HOLDERS = 1, PROC_SCAN_ALL = 2 };
+
+// Walks the processes under g_procRoot and folds the holders into g_procRows.
+// On a timed scan a process whose start time and fd count match the last
+// scan keeps the devices found then; only new ones (or a reused PID) and ones
+// whose fd count moved have their fds read. With mode PROC_SCAN_HOLDERS only
+// the processes that held a device last time are looked at (any row whose
+// holders are gone is stopped).
+static void Proc_Load(std::vector<CamRow>& out, int mode) {
+    out.clear();
+    ProcRows& pr = g_procRows;
+    int procFd = open(g_procRoot.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (procFd < 0) return;
+    const ULONGLONG scan = ++pr.scans;
+    const ULONGLONG bootFt = Proc_BootFt(procFd);
+    const long hz = std::max(1L, sysconf(_SC_CLK_TCK));
+    const std::string devPrefix = g_devRoot + '/';
+    struct statfs fs {};
+    const bool procfs = fstatfs(procFd, &fs) == 0 && fs.f_type == PROC_SUPER_MAGIC;
+    std::vector<ProcHolder> holders;
+    std::string comm;
+    auto scanPid = [&](int pid, const char* name) {
+        int pidFd = openat(procFd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (pidFd < 0) {
+            Proc_Forget(pr, pid); // exited
+            return;
+        }
+        char stat[1024];
+        ULONGLONG startTicks = 0;
+        if (Proc_ReadAt(pidFd, "stat", stat, sizeof(stat)) && Proc_ParseStat(stat, startTicks, comm)) {
+            const uint32_t fdCount = Proc_FdCount(pidFd, procfs);
+            ProcEntry& e = pr.procs[pid];
+            if (e.seen != 0 && e.startTicks != startTicks) e = ProcEntry(); // PID reused
+            if (mode != PROC_SCAN_NONE || e.seen == 0 || e.fdCount != fdCount || fdCount == 0) {
+                e.startTicks = startTicks;
+                e.fdCount = fdCount;
+                e.caps.clear();
+                Proc_ScanFds(pidFd, devPrefix, e.caps);
+            }
+            e.seen = scan;
+            if (!e.caps.empty()) {
+                if (!e.cgroupRead) Proc_Container(pidFd, pr, e);
+                const ProcIdentity& id = Proc_LookupIdentity(pr.identities, pidFd, pid, startTicks,
+                    bootFt ? bootFt + startTicks * kTicksPerSecond / static_cast<ULONGLONG>(hz) : 0, comm);
+                ProcHolder h{ pid, id.startFt, id.exe, id.app, e.container, nullptr };
+                for (const wchar_t* cap : e.caps) {
+                    h.capability = cap;
+                    holders.push_back(h);
+                }
+            }
+        }
+        close(pidFd);
+    };
+    if (mode == PROC_SCAN_HOLDERS && scan > 1) {
+        char name[16];
+        for (int pid : pr.holderPids) {
+            snprintf(name, sizeof(name), "%d", pid);
+            scanPid(pid, name);
+        }
+    }
+    else {
+        Proc_ForEachEntry(procFd, [&](const char* name) {
+            if (Proc_IsPid(name)) scanPid(atoi(name), name);
+        });
+        // Processes not listed any more have exited; their identities and any
+        // cgroup no remaining process is in are forgotten.
+        std::unordered_map<uint64_t, std::wstring> cgroups;
+        for (auto it = pr.procs.begin(); it != pr.procs.end();) {
+            if (it->second.seen != scan) {
+                it = pr.procs.erase(it);
+                continue;
+            }
+            auto cg = pr.cgroups.find(it->second.cgroup);
+            if (cg != pr.cgroups.end()) cgroups.insert(*cg);
+            ++it;
+        }
+        pr.cgroups.swap(cgroups);
+        IdentityCache& ids = pr.identities;
+        for (auto it = ids.lru.begin(); it != ids.lru.end();) {
+            auto p = pr.procs.find(static_cast<int>(it->key >> 40));
+            if (p != pr.procs.end() && Proc_IdentityKey(p->first, p->second.startTicks) == it->key) {
+                ++it;
+                continue;
+            }
+            ids.byKey.erase(it->key);
+            it = ids.lru.erase(it);
+        }
+    }
+    close(procFd);
+
+    pr.holderPids.clear();
+    for (const ProcHolder& h : holders) {
+        if (pr.holderPids.empty() || pr.holderPids.back() != h.pid) pr.holderPids.push_back(h.pid);
+    }
+    const ULONGLONG now = NowFt();
+    for (ProcHolder& h : holders) {
+        ProcRow& p = pr.byKey[std::wstring(h.capability) + L'|' + h.exe + L'|' + h.app + L'|' + h.container];
+        CamRow& r = p.row;
+        if (r.capability.empty()) {
+            r.kind = L"Desktop";
+            r.capability = h.capability;
+            r.exe = h.exe;
+            r.app = h.app;
+            r.container = h.container;
+            KnownApp_Apply(r);
+        }
+        if (!r.activeNow) {
+            // The first scan cannot tell when the device was opened; the
+            // process start is the earliest it can have been.
+            r.activeNow = true;
+            r.startFt = scan == 1 ? h.startFt : now;
+            r.stopFt = 0;
+        }
+        else if (scan == 1 && p.seen == scan) {
+            r.startFt = std::min(r.startFt, h.startFt);
+        }
+        p.seen = scan;
+    }
+    out.reserve(pr.byKey.size());
+    for (auto& kv : pr.byKey) {
+        ProcRow& p = kv.second;
+        if (p.row.activeNow && p.seen != scan) {
+            p.row.activeNow = false;
+            p.row.stopFt = now;
+        }
+        out.push_back(p.row);
+    }
+    SortRows(out);
+}
+
+// ---- Device watch ----
+// Instead of walking /proc on a timer, the device nodes are watched with
+// inotify: an open means some process may have become a holder (walk every
+// process), a close that one of the known holders may have let go (look at
+// those only). Nodes added later (hotplug) are picked up from the watch on the
+// device directories. The timer is kept as a slow fallback for fds that arrive
+// without an open, e.g. inherited across fork.
+const unsigned kDeviceWatchFallbackMs = 60000;
+const unsigned kDeviceSettleMs = 20; // let a burst of open/close (probing) finish
+
+struct DeviceWatch {
+    int fd{ -1 };
+    std::unordered_map<int, std::string> dirs;  // watch descriptor -> directory ("" or "snd/")
+    std::unordered_map<int, std::string> nodes; // watch descriptor -> node name
+    int pending{ PROC_SCAN_NONE };              // what the events so far call for
+};
+static DeviceWatch g_devWatch;
+
+// True if some matcher's nodes live directly in dir ("" or e.g. "snd/").
+static bool DevWatch_IsMatcherDir(std::string_view dir) {
+    for (const DeviceMatcher& m : kDeviceMatchers) {
+        std::string_view p = m.pattern;
+        size_t slash = p.rfind('/');
+        if (p.substr(0, slash == std::string_view::npos ? 0 : slash + 1) == dir) return true;
+    }
+    return false;
+}
+
+static void DevWatch_AddNode(DeviceWatch& w, const std::string& name) {
+    if (!Proc_DeviceCapability(name.c_str())) return;
+    std::string path = g_devRoot + '/' + name;
+    int wd = inotify_add_watch(w.fd, path.c_str(), IN_OPEN | IN_CLOSE);
+    if (wd >= 0) w.nodes[wd] = name;
+}
+
+// Watches dir for new nodes and every matching node already in it.
+static bool DevWatch_AddDir(DeviceWatch& w, const std::string& dir) {
+    std::string path = g_devRoot + '/' + dir;
+    int wd = inotify_add_watch(w.fd, path.c_str(), IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+    if (wd < 0) return false;
+    w.dirs[wd] = dir;
+    int dirFd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) return true;
+    Proc_ForEachEntry(dirFd, [&](const char* name) { DevWatch_AddNode(w, dir + name); });
+    close(dirFd);
+    return true;
+}
+
+// Starts watching g_devRoot, the matchers' subdirectories that exist, and the
+// device nodes in them; false if inotify is not available (the caller keeps
+// scanning on its timer).
+static bool DevWatch_Open() {
+    DeviceWatch& w = g_devWatch;
+    w.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w.fd < 0) return false;
+    if (!DevWatch_AddDir(w, std::string())) {
+        close(w.fd);
+        w.fd = -1;
+        return false;
+    }
+    for (const DeviceMatcher& m : kDeviceMatchers) {
+        std::string_view p = m.pattern;
+        size_t slash = p.rfind('/');
+        if (slash == std::string_view::npos) continue;
+        std::string dir(p.substr(0, slash + 1));
+        bool watched = false;
+        for (const auto& d : w.dirs) watched |= d.second == dir;
+        if (!watched) DevWatch_AddDir(w, dir); // may appear later; then its parent reports it
+    }
+    return true;
+}
+
+// Reads the queued events into w.pending.
+static void DevWatch_Drain(DeviceWatch& w) {
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        ssize_t n = read(w.fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (ssize_t off = 0; off < n;) {
+            const inotify_event* e = reinterpret_cast<const inotify_event*>(buf + off);
+            off += static_cast<ssize_t>(sizeof(inotify_event) + e->len);
+            auto dir = w.dirs.find(e->wd);
+            if (e->mask & IN_IGNORED) {
+                // node or directory removed
+                if (dir != w.dirs.end()) w.dirs.erase(dir);
+                else w.nodes.erase(e->wd);
+            }
+            else if (dir != w.dirs.end()) {
+                if (!e->len || !(e->mask & (IN_CREATE | IN_MOVED_TO))) continue;
+                std::string name = dir->second + e->name;
+                // Either may have been opened before the watch was added.
+                if ((e->mask & IN_ISDIR) && DevWatch_IsMatcherDir(name + '/')) {
+                    DevWatch_AddDir(w, name + '/');
+                    w.pending |= PROC_SCAN_ALL;
+                }
+                else if (Proc_DeviceCapability(name.c_str())) {
+                    DevWatch_AddNode(w, name);
+                    w.pending |= PROC_SCAN_ALL;
+                }
+            }
+            else if (e->mask & IN_OPEN) {
+                w.pending |= PROC_SCAN_ALL;
+            }
+            else if (e->mask & IN_CLOSE) {
+                w.pending |= PROC_SCAN_HOLDERS;
+            }
+        }
+    }
+}
+
+// Waits up to ms for a device event. Returns true once one has arrived and
+// the burst around it has settled; false on timeout or a signal.
+static bool DevWatch_Wait(unsigned ms) {
+    DeviceWatch& w = g_devWatch;
+    pollfd p{ w.fd, POLLIN, 0 };
+    if (poll(&p, 1, static_cast<int>(ms)) <= 0) return w.pending != PROC_SCAN_NONE;
+    do {
+        DevWatch_Drain(w);
+    } while (poll(&p, 1, static_cast<int>(kDeviceSettleMs)) > 0);
+    return w.pending != PROC_SCAN_NONE;
+}
+
+// How much of /proc the next refresh has to read (a PROC_SCAN_ mode);
+// resets the pending events.
+static int DevWatch_TakePending() {
+    DeviceWatch& w = g_devWatch;
+    int mode = w.fd < 0 ? PROC_SCAN_NONE : (w.pending & PROC_SCAN_ALL) ? PROC_SCAN_ALL : w.pending;
+    w.pending = PROC_SCAN_NONE;
+    return mode;
+}
+#endif // __linux__
+
+// ---------------------- Snapshot Publication ----------------
+// Each refresh publishes an immutable snapshot. Readers (query server, etc.)
+// take a reference to the current one and never block the scanner; the
+// scanner swaps in the next one without waiting for readers.
+const uint32_t kNoRow = 0xFFFFFFFF;
+
+struct Snapshot {
+    ULONGLONG version{ 0 };
+    std::vector<CamRow> rows;
+    std::string wire;                 // rows pre-encoded for the query server
+    std::vector<uint32_t> wireOffset; // rows.size() + 1 offsets into wire
+    // Diff against the snapshot published just before this one
+    std::vector<uint32_t> fromPrev;   // per row: its index there, or kNoRow if new
+    std::vector<uint32_t> removed;    // indices there of rows that are gone
+    std::vector<uint32_t> changed;    // rows new or changed in this version, ascending
+    // Per-column sort keys (Column_Key), parallel to rows
+    std::vector<ULONGLONG> sortKey[kColumnCount];
+};
+
+static std::shared_ptr<const Snapshot> g_snapshot = std::make_shared<const Snapshot>();
+
+static std::shared_ptr<const Snapshot> CurrentSnapshot() {
+    return std::atomic_load(&g_snapshot);
+}
+
+template <size_t... C>
+static std::wstring KeyOf(const CamRow& r, std::index_sequence<C...> columns) {
+    std::wstring key;
+    ForEachColumn([&](auto c) {
+        key += r.*ColumnAt<c>::field;
+        key += L'|';
+    }, columns);
+    return key;
+}
+
+static std::wstring RowKey(const CamRow& r) { return KeyOf(r, IdentityColumns()); }
+static std::wstring AppKey(const CamRow& r) { return KeyOf(r, AppColumns()); }
+
+// True if a and b agree in every column, so the row has not changed.
+template <size_t... C>
+static bool SameColumns(const CamRow& a, const CamRow& b, std::index_sequence<C...>) {
+    return ((a.*ColumnAt<C>::field == b.*ColumnAt<C>::field) && ...);
+}
+
+// Little-endian integer framing shared by the query server encoders.
+static void PutLE(std::string& out, ULONGLONG v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out += static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+static void PokeLE(std::string& out, size_t at, ULONGLONG v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out[at + i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+}
+
+static ULONGLONG GetLE(const uint8_t* p, int bytes) {
+    ULONGLONG v = 0;
+    for (int i = 0; i < bytes; ++i) v |= static_cast<ULONGLONG>(p[i]) << (8 * i);
+    return v;
+}
+
+static void PutUtf8Field(std::string& out, const std::wstring& s) {
+    size_t at = out.size();
+    PutLE(out, 0, 2);
+    AppendUtf8(out, s);
+    size_t len = std::min<size_t>(out.size() - at - 2, 0xFFFF);
+    out.resize(at + 2 + len);
+    PokeLE(out, at, len, 2);
+}
+
+// The string fields of a wire row, in order (see Local Query Server). New
+// ones go at the end; the reply header carries their count.
+static std::wstring CamRow::* const kWireStrings[] = {
+    &CamRow::app, &CamRow::exe, &CamRow::capability, &CamRow::user, &CamRow::container,
+    &CamRow::product, &CamRow::company, &CamRow::version, &CamRow::sha256, &CamRow::signer,
+    &CamRow::signerIssuer, &CamRow::name, &CamRow::category, &CamRow::policy,
+};
+
+static void EncodeRow(std::string& out, const CamRow& r) {
+    out += static_cast<char>(r.kind == L"Desktop" ? 1 : 0);
+    out += static_cast<char>(r.activeNow ? 1 : 0);
+    PutLE(out, r.startFt, 8);
+    PutLE(out, r.stopFt, 8);
+    PutLE(out, r.changedIn, 8);
+    for (std::wstring CamRow::* f : kWireStrings) PutUtf8Field(out, r.*f);
+}
+
+// Stamps rows with the version they last changed in (carried over from the
+// previous snapshot when identical) and makes them the current snapshot.
+// Returns the number of rows inserted, changed or removed.
+static size_t PublishSnapshot(std::vector<CamRow>& rows) {
+    std::shared_ptr<const Snapshot> prev = CurrentSnapshot();
+    auto next = std::make_shared<Snapshot>();
+    next->version = prev->version + 1;
+
+    std::unordered_map<std::wstring, uint32_t> before;
+    before.reserve(prev->rows.size());
+    for (size_t i = 0; i < prev->rows.size(); ++i) before.emplace(RowKey(prev->rows[i]), static_cast<uint32_t>(i));
+
+    std::vector<bool> kept(prev->rows.size(), false);
+    next->fromPrev.reserve(rows.size());
+    next->wireOffset.reserve(rows.size() + 1);
+    for (auto& k : next->sortKey) k.reserve(rows.size());
+    for (auto& r : rows) {
+        auto it = before.find(RowKey(r));
+        const CamRow* old = nullptr;
+        if (it != before.end() && !kept[it->second]) {
+            old = &prev->rows[it->second];
+            kept[it->second] = true;
+        }
+        bool same = old && SameColumns(*old, r, std::make_index_sequence<kColumnCount>());
+        r.changedIn = same ? old->changedIn : next->version;
+        if (!same) next->changed.push_back(static_cast<uint32_t>(next->fromPrev.size()));
+        next->fromPrev.push_back(old ? it->second : kNoRow);
+
+        next->wireOffset.push_back(static_cast<uint32_t>(next->wire.size()));
+        EncodeRow(next->wire, r);
+
+        ForEachColumn([&](auto c) { next->sortKey[c].push_back(Column_Key<c>(r)); });
+    }
+    next->wireOffset.push_back(static_cast<uint32_t>(next->wire.size()));
+    for (size_t i = 0; i < kept.size(); ++i) {
+        if (!kept[i]) next->removed.push_back(static_cast<uint32_t>(i));
+    }
+    next->rows = rows;
+
+    size_t changed = next->changed.size() + next->removed.size();
+    std::atomic_store(&g_snapshot, std::shared_ptr<const Snapshot>(std::move(next)));
+    return changed;
+}
+
+// ---------------------- Local Query Server ------------------
+// Compact binary protocol, any number of requests per connection:
+//   Request  (9 bytes): u8 op, u64 arg
+//     op 1 = current snapshot, 2 = active rows only, 3 = rows changed after version arg
+//   Response: u32 payload bytes, then payload:
+//     u16 layout (kIpcLayout), u16 string fields per row (n),
+//     u64 version, u32 rows in snapshot, u32 rows that follow, rows...
+//   Row: u8 kind (0 Packaged, 1 Desktop), u8 active, u64 start, u64 stop,
+//        u64 changedIn, then n times u16 len + UTF-8: app, exe, capability,
+//        user, container, product, company, version, sha256, signer,
+//        signerIssuer, name, category, policy (kWireStrings)
+// All integers are little-endian. Fields are only ever appended, so a client
+// reads the ones it knows and skips the remaining n - known. The layout
+// changes when anything else does. Replies are served from the pre-encoded
+// snapshot and never trigger a scan.
+enum IpcOp : uint8_t { IPC_CURRENT = 1, IPC_ACTIVE = 2, IPC_SINCE = 3 };
+const uint16_t kIpcLayout = 1;
+
+static void Ipc_BuildReply(const uint8_t req[9], std::string& out) {
+    std::shared_ptr<const Snapshot> snap = CurrentSnapshot();
+    const uint8_t op = req[0];
+    const ULONGLONG since = GetLE(req + 1, 8);
+
+    out.clear();
+    PutLE(out, 0, 4);
+    PutLE(out, kIpcLayout, 2);
+    PutLE(out, std::size(kWireStrings), 2);
+    PutLE(out, snap->version, 8);
+    PutLE(out, snap->rows.size(), 4);
+    PutLE(out, 0, 4);
+
+    size_t count = 0;
+    if (op == IPC_CURRENT) {
+        out.append(snap->wire);
+        count = snap->rows.size();
+    }
+    else if (op == IPC_ACTIVE || op == IPC_SINCE) {
+        for (size_t i = 0; i < snap->rows.size(); ++i) {
+            const CamRow& r = snap->rows[i];
+            if (op == IPC_ACTIVE ? !r.activeNow : r.changedIn <= since) continue;
+            out.append(snap->wire, snap->wireOffset[i], snap->wireOffset[i + 1] - snap->wireOffset[i]);
+            ++count;
+        }
+    }
+
+    PokeLE(out, 0, out.size() - 4, 4);
+    PokeLE(out, 20, count, 4);
+}
+
+#ifdef _WIN32
+typedef HANDLE IpcHandle;
+
+static bool Ipc_Read(IpcHandle h, void* buf, size_t len) {
+    char* p = static_cast<char*>(buf);
+    while (len > 0) {
+        DWORD got = 0;
+        if (!ReadFile(h, p, static_cast<DWORD>(len), &got, nullptr) || got == 0) return false;
+        p += got; len -= got;
+    }
+    return true;
+}
+
+static bool Ipc_Write(IpcHandle h, const void* buf, size_t len) {
+    const char* p = static_cast<const char*>(buf);
+    while (len > 0) {
+        DWORD put = 0;
+        if (!WriteFile(h, p, static_cast<DWORD>(len), &put, nullptr)) return false;
+        p += put; len -= put;
+    }
+    return true;
+}
+
+static void Ipc_Close(IpcHandle h) {
+    DisconnectNamedPipe(h);
+    CloseHandle(h);
+}
+#else
+typedef int IpcHandle;
+
+static bool Ipc_Read(IpcHandle h, void* buf, size_t len) {
+    char* p = static_cast<char*>(buf);
+    while (len > 0) {
+        ssize_t got = read(h, p, len);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        p += got; len -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+static bool Ipc_Write(IpcHandle h, const void* buf, size_t len) {
+    const char* p = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t put = send(h, p, len, MSG_NOSIGNAL);
+        if (put < 0 && errno == EINTR) continue;
+        if (put <= 0) return false;
+        p += put; len -= static_cast<size_t>(put);
+    }
+    return true;
+}
+
+static void Ipc_Close(IpcHandle h) {
+    close(h);
+}
+#endif
+
+// Connections served at once; further ones are closed straight away, so a
+// misbehaving client cannot pile up threads.
+const unsigned kIpcMaxClients = 32;
+static std::atomic<unsigned> g_ipcClients{ 0 };
+
+static void Ipc_ServeClient(IpcHandle h) {
+    std::string reply;
+    uint8_t req[9];
+    while (Ipc_Read(h, req, sizeof(req))) {
+        Ipc_BuildReply(req, reply);
+        if (!Ipc_Write(h, reply.data(), reply.size())) break;
+    }
+    Ipc_Close(h);
+    --g_ipcClients;
+}
+
+static void Ipc_Spawn(IpcHandle h) {
+    if (++g_ipcClients > kIpcMaxClients) {
+        Ipc_Close(h);
+        --g_ipcClients;
+        return;
+    }
+    std::thread(Ipc_ServeClient, h).detach();
+}
+
+#ifdef _WIN32
+static bool Ipc_StartServer() {
+    std::thread([] {
+        for (;;) {
+            HANDLE h = CreateNamedPipeW(kPipeName, PIPE_ACCESS_DUPLEX,
+                PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                PIPE_UNLIMITED_INSTANCES, 64 * 1024, 64 * 1024, 0, nullptr);
+            if (h == INVALID_HANDLE_VALUE) return;
+            if (!ConnectNamedPipe(h, nullptr) && GetLastError() != ERROR_PIPE_CONNECTED) {
+                CloseHandle(h);
+                continue;
+            }
+            Ipc_Spawn(h);
+        }
+        }).detach();
+    return true;
+}
+#else
+// $XDG_RUNTIME_DIR (private to the user) when there is one, else a per-user
+// name in /tmp.
+static std::string Ipc_DefaultSocketPath() {
+    const char* dir = getenv("XDG_RUNTIME_DIR");
+    if (dir && *dir) return std::string(dir) + "/camusage.sock";
+    return "/tmp/camusage-" + std::to_string(geteuid()) + ".sock";
+}
+
+// Removes a socket left behind by an instance that has exited. A live
+// instance's socket, another user's file or anything that is not a socket
+// is left alone, and the path cannot be used.
+static bool Ipc_ClaimPath(const sockaddr_un& addr) {
+    struct stat st {};
+    if (lstat(addr.sun_path, &st) != 0) return errno == ENOENT;
+    if (!S_ISSOCK(st.st_mode) || st.st_uid != geteuid()) return false;
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) return false;
+    const bool stale = connect(probe, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 && errno == ECONNREFUSED;
+    close(probe);
+    return stale && unlink(addr.sun_path) == 0;
+}
+
+static bool Ipc_StartServer(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    if (!Ipc_ClaimPath(addr)) return false;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return false;
+    }
+    // Owner only, before listen() so nobody can connect in between.
+    if (chmod(addr.sun_path, 0600) != 0 || listen(fd, 64) != 0) {
+        unlink(addr.sun_path);
+        close(fd);
+        return false;
+    }
+
+    std::thread([fd] {
+        for (;;) {
+            int c = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (c < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // out of fds: wait for some to close
+                    continue;
+                }
+                return;
+            }
+            Ipc_Spawn(c);
+        }
+        }).detach();
+    return true;
+}
+#endif
+
+// ---------------------- Metrics Endpoint --------------------
+// Prometheus text exposition on http://127.0.0.1:<port>/metrics. The refresh
+// path bumps the counters below; each scrape renders them, plus gauges taken
+// from the current snapshot. Scrapes are served on their own threads with a
+// short socket timeout, so a client that stalls only holds up itself.
+const double kScanBuckets[] = { 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5 };
+
+struct Metrics {
+    std::atomic<ULONGLONG> refreshes{ 0 };
+    std::atomic<ULONGLONG> scanBucket[std::size(kScanBuckets) + 1]{}; // last is +Inf
+    std::atomic<ULONGLONG> scanMicros{ 0 };
+    std::atomic<ULONGLONG> regCallsLast{ 0 };
+    std::atomic<ULONGLONG> regCallsTotal{ 0 };
+    std::atomic<ULONGLONG> rowsChangedLast{ 0 };
+    std::atomic<ULONGLONG> rowsChangedTotal{ 0 };
+    std::atomic<ULONGLONG> avOverlapApps{ 0 };
+    std::atomic<ULONGLONG> avOverlapSeconds{ 0 };
+};
+
+static Metrics g_metrics;
+
+static void Metrics_RecordRefresh(double scanSeconds, ULONGLONG regCalls, size_t rowsChanged) {
+    size_t b = 0;
+    while (b < std::size(kScanBuckets) && scanSeconds > kScanBuckets[b]) ++b;
+    g_metrics.scanBucket[b]++;
+    g_metrics.scanMicros += static_cast<ULONGLONG>(scanSeconds * 1e6);
+    g_metrics.regCallsLast = regCalls;
+    g_metrics.regCallsTotal += regCalls;
+    g_metrics.rowsChangedLast = rowsChanged;
+    g_metrics.rowsChangedTotal += rowsChanged;
+    g_metrics.refreshes++;
+}
+
+// Apps with camera and microphone on right now, and the overlap recorded so far.
+static void Metrics_RecordOverlap(ULONGLONG apps, ULONGLONG seconds) {
+    g_metrics.avOverlapApps = apps;
+    g_metrics.avOverlapSeconds = seconds;
+}
+
+static ULONGLONG ResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc{};
+    pmc.cb = sizeof(pmc);
+    return GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) ? pmc.WorkingSetSize : 0;
+#else
+    unsigned long long pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    if (fscanf(f, "%llu %llu", &pages, &resident) != 2) resident = 0;
+    fclose(f);
+    return resident * static_cast<ULONGLONG>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+static void Metrics_Header(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP "; out += name; out += ' '; out += help; out += '\n';
+    out += "# TYPE "; out += name; out += ' '; out += type; out += '\n';
+}
+
+static void Metrics_Value(std::string& out, const char* name, const char* labels, ULONGLONG v) {
+    char buf[160];
+    int n = snprintf(buf, sizeof(buf), "%s%s %llu\n", name, labels, v);
+    out.append(buf, static_cast<size_t>(n));
+}
+
+static void Metrics_Render(std::string& out) {
+    std::shared_ptr<const Snapshot> snap = CurrentSnapshot();
+    std::map<std::wstring, ULONGLONG> active; // by capability
+    for (const wchar_t* cap : kCapabilities) active[cap] = 0;
+    ULONGLONG desktop = 0, packaged = 0, denied = 0, unlisted = 0;
+    bool policy = false;
+    for (const auto& r : snap->rows) {
+        active[r.capability] += r.activeNow;
+        (r.kind == L"Desktop" ? desktop : packaged)++;
+        policy |= !r.policy.empty();
+        denied += r.activeNow && r.policy == L"denied";
+        unlisted += r.activeNow && r.policy == L"unlisted";
+    }
+
+    out.clear();
+    Metrics_Header(out, "camusage_active_sessions", "gauge", "Apps currently using each capability.");
+    std::string capLabel;
+    for (const auto& a : active) {
+        capLabel = "{capability=\"";
+        AppendUtf8(capLabel, a.first);
+        capLabel += "\"}";
+        Metrics_Value(out, "camusage_active_sessions", capLabel.c_str(), a.second);
+    }
+    if (policy) {
+        Metrics_Header(out, "camusage_policy_violations", "gauge", "Active sessions of apps a deny rule matches, or no allow rule does.");
+        Metrics_Value(out, "camusage_policy_violations", "{policy=\"denied\"}", denied);
+        Metrics_Value(out, "camusage_policy_violations", "{policy=\"unlisted\"}", unlisted);
+    }
+    Metrics_Header(out, "camusage_rows", "gauge", "Rows in the current snapshot by kind.");
+    Metrics_Value(out, "camusage_rows", "{kind=\"Desktop\"}", desktop);
+    Metrics_Value(out, "camusage_rows", "{kind=\"Packaged\"}", packaged);
+    Metrics_Header(out, "camusage_snapshot_version", "gauge", "Version of the current snapshot.");
+    Metrics_Value(out, "camusage_snapshot_version", "", snap->version);
+    Metrics_Header(out, "camusage_refreshes_total", "counter", "Refreshes since start.");
+    Metrics_Value(out, "camusage_refreshes_total", "", g_metrics.refreshes);
+
+    Metrics_Header(out, "camusage_scan_duration_seconds", "histogram", "Time spent scanning per refresh.");
+    ULONGLONG cumulative = 0;
+    char label[48];
+    for (size_t b = 0; b <= std::size(kScanBuckets); ++b) {
+        cumulative += g_metrics.scanBucket[b];
+        if (b < std::size(kScanBuckets)) snprintf(label, sizeof(label), "{le=\"%g\"}", kScanBuckets[b]);
+        else snprintf(label, sizeof(label), "{le=\"+Inf\"}");
+        Metrics_Value(out, "camusage_scan_duration_seconds_bucket", label, cumulative);
+    }
+    char sum[64];
+    int n = snprintf(sum, sizeof(sum), "camusage_scan_duration_seconds_sum %.6f\n", g_metrics.scanMicros / 1e6);
+    out.append(sum, static_cast<size_t>(n));
+    Metrics_Value(out, "camusage_scan_duration_seconds_count", "", cumulative);
+
+    Metrics_Header(out, "camusage_registry_calls_last_scan", "gauge", "Registry calls made by the last scan.");
+    Metrics_Value(out, "camusage_registry_calls_last_scan", "", g_metrics.regCallsLast);
+    Metrics_Header(out, "camusage_registry_calls_total", "counter", "Registry calls made by all scans.");
+    Metrics_Value(out, "camusage_registry_calls_total", "", g_metrics.regCallsTotal);
+    Metrics_Header(out, "camusage_rows_changed_last_refresh", "gauge", "Rows inserted, changed or removed by the last refresh.");
+    Metrics_Value(out, "camusage_rows_changed_last_refresh", "", g_metrics.rowsChangedLast);
+    Metrics_Header(out, "camusage_rows_changed_total", "counter", "Rows inserted, changed or removed by all refreshes.");
+    Metrics_Value(out, "camusage_rows_changed_total", "", g_metrics.rowsChangedTotal);
+    Metrics_Header(out, "camusage_camera_microphone_overlap_apps", "gauge", "Apps using the camera and the microphone at the same time.");
+    Metrics_Value(out, "camusage_camera_microphone_overlap_apps", "", g_metrics.avOverlapApps);
+    Metrics_Header(out, "camusage_camera_microphone_overlap_seconds_total", "counter", "Time apps have had the camera and the microphone on together since start.");
+    Metrics_Value(out, "camusage_camera_microphone_overlap_seconds_total", "", g_metrics.avOverlapSeconds);
+    Metrics_Header(out, "camusage_resident_bytes", "gauge", "Resident memory of this process.");
+    Metrics_Value(out, "camusage_resident_bytes", "", ResidentBytes());
+}
+
+#ifdef _WIN32
+typedef SOCKET NetSocket;
+const NetSocket kNoSocket = INVALID_SOCKET;
+static void Net_Close(NetSocket s) { closesocket(s); }
+#else
+typedef int NetSocket;
+const NetSocket kNoSocket = -1;
+static void Net_Close(NetSocket s) { close(s); }
+#endif
+
+static bool Net_SendAll(NetSocket s, const std::string& data) {
+    size_t off = 0;
+    while (off < data.size()) {
+#ifdef _WIN32
+        int put = send(s, data.data() + off, static_cast<int>(data.size() - off), 0);
+#else
+        ssize_t put = send(s, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+#endif
+        if (put <= 0) return false;
+        off += static_cast<size_t>(put);
+    }
+    return true;
+}
+
+const unsigned kMetricsTimeoutMs = 500;    // per receive or send on a scrape
+const unsigned kMetricsMaxClients = 8;     // scrapes served at once; more are closed
+const unsigned kMetricsBackoffMaxMs = 1000; // between failing accepts
+
+// One slot per scrape that may be in flight. The exposition text and reply
+// header are rendered into the slot's strings, which keep their capacity, so
+// a steady scraper allocates nothing; the cost is up to kMetricsMaxClients
+// copies of the largest page held for the life of the process. Only the
+// accept thread claims slots; a client thread frees its slot when done.
+struct MetricsSlot {
+    std::atomic<bool> busy{ false };
+    std::string body, head;
+};
+static MetricsSlot g_metricsSlots[kMetricsMaxClients];
+
+static void Metrics_ServeClient(NetSocket c, MetricsSlot* slot) {
+#ifdef _WIN32
+    DWORD timeout = kMetricsTimeoutMs;
+    setsockopt(c, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+    setsockopt(c, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+#else
+    timeval timeout{ 0, kMetricsTimeoutMs * 1000 };
+    setsockopt(c, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(c, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#endif
+    char req[2048];
+    size_t got = 0;
+    while (got < sizeof(req) - 1) {
+        int n = static_cast<int>(recv(c, req + got, static_cast<int>(sizeof(req) - 1 - got), 0));
+        if (n <= 0) break;
+        got += static_cast<size_t>(n);
+        req[got] = 0;
+        if (strstr(req, "\r\n\r\n")) break;
+    }
+
+    std::string& body = slot->body;
+    std::string& head = slot->head;
+    bool ok = got > 12 && strncmp(req, "GET /metrics", 12) == 0 && (req[12] == ' ' || req[12] == '?');
+    if (ok) Metrics_Render(body);
+    else body.assign("not found\n");
+
+    head.assign(ok ? "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        : "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n");
+    head += "Content-Length: ";
+    head += std::to_string(body.size());
+    head += "\r\nConnection: close\r\n\r\n";
+    if (Net_SendAll(c, head)) Net_SendAll(c, body);
+    Net_Close(c);
+    slot->busy.store(false, std::memory_order_release);
+}
+
+static void Metrics_Serve(NetSocket ls) {
+    unsigned backoffMs = 0;
+    for (;;) {
+        NetSocket c = accept(ls, nullptr, nullptr);
+        if (c == kNoSocket) {
+            // e.g. out of fds: wait for some to be closed instead of spinning
+            backoffMs = std::min(kMetricsBackoffMaxMs, backoffMs ? backoffMs * 2 : 10);
+            std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
+            continue;
+        }
+        backoffMs = 0;
+        MetricsSlot* slot = nullptr;
+        for (MetricsSlot& m : g_metricsSlots) {
+            if (!m.busy.load(std::memory_order_acquire)) {
+                slot = &m;
+                break;
+            }
+        }
+        if (!slot) {
+            Net_Close(c);
+            continue;
+        }
+        slot->busy.store(true, std::memory_order_relaxed);
+        std::thread(Metrics_ServeClient, c, slot).detach();
+    }
+}
+
+static bool Metrics_StartServer(unsigned short port) {
+#ifdef _WIN32
+    WSADATA wsa{};
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+    NetSocket ls = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+#else
+    NetSocket ls = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#endif
+    if (ls == kNoSocket) return false;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(ls, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(ls, 16) != 0) {
+        Net_Close(ls);
+        return false;
+    }
+    std::thread(Metrics_Serve, ls).detach();
+    return true;
+}
+
+// ---------------------- Shared-Memory Snapshot --------------
+// The latest snapshot is also published in a named shared-memory region
+// (Local\CamUsageWin.Snapshot, which is per session, or POSIX shm
+// /camusage-<euid>.snapshot, mode 0600, as private as the query socket) so
+// local consumers can map it read-only and read rows in place. The region holds
+// two row buffers; the writer fills the inactive one and then flips
+// ShmHeader::active. Each buffer carries its own sequence counter, odd while
+// it is being written. A reader:
+//   1. b = active; s1 = buffer[b].seq (retry while odd)
+//   2. read rows[0 .. rowCount) in place
+//   3. acquire fence; retry if buffer[b].seq != s1
+// Strings are UTF-8, truncated to the fixed field sizes at a character
+// boundary. Rows beyond kShmCapacity are dropped (totalRows keeps the count).
+const uint32_t kShmMagic = 0x554D4143; // "CAMU"
+const uint32_t kShmLayout = 9;
+const uint32_t kShmCapacity = 4096;
+
+struct ShmRow {
+    uint8_t  kind;       // 0 Packaged, 1 Desktop
+    uint8_t  active;
+    uint16_t appLen;
+    uint16_t exeLen;
+    uint16_t capabilityLen;
+    uint16_t userLen;
+    uint16_t containerLen;
+    uint16_t productLen;
+    uint16_t companyLen;
+    uint16_t versionLen;
+    uint16_t sha256Len;
+    uint16_t signerLen;
+    uint16_t signerIssuerLen;
+    uint16_t nameLen;
+    uint16_t categoryLen;
+    uint16_t policyLen;
+    uint16_t reserved;
+    uint64_t startFt;
+    uint64_t stopFt;
+    uint64_t changedIn;
+    char     app[128];
+    char     exe[512];
+    char     capability[32];
+    char     user[64];
+    char     container[64];
+    char     product[64];
+    char     company[64];
+    char     version[32];
+    char     sha256[64];  // hex, no terminator
+    char     signer[64];
+    char     signerIssuer[64];
+    char     name[64];
+    char     category[32];
+    char     policy[16];
+};
+
+struct ShmBuffer {
+    std::atomic<uint64_t> seq;
+    uint64_t version;
+    uint32_t rowCount;
+    uint32_t totalRows;
+    ShmRow   rows[kShmCapacity];
+};
+
+struct ShmHeader {
+    uint32_t magic;
+    uint32_t layout;
+    uint32_t capacity;
+    uint32_t rowSize;
+    std::atomic<uint32_t> active;
+    uint32_t reserved;
+    uint64_t bufferOffset[2];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory seqlock needs lock-free 64-bit atomics");
+
+const size_t kShmBufferOffset = (sizeof(ShmHeader) + 63) & ~size_t(63);
+const size_t kShmSize = kShmBufferOffset + 2 * sizeof(ShmBuffer);
+
+static ShmHeader* g_shm = nullptr;
+
+static ShmBuffer* Shm_Buffer(uint32_t i) {
+    return reinterpret_cast<ShmBuffer*>(reinterpret_cast<char*>(g_shm) + g_shm->bufferOffset[i]);
+}
+
+#ifndef _WIN32
+static std::string Shm_Name() {
+    return "/camusage-" + std::to_string(geteuid()) + ".snapshot";
+}
+#endif
+
+// Creates or attaches the region; false if it cannot, or (POSIX) if a
+// region of that name belongs to someone else.
+static bool Shm_Open() {
+    void* view = nullptr;
+#ifdef _WIN32
+    HANDLE hMap = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(static_cast<ULONGLONG>(kShmSize) >> 32), static_cast<DWORD>(kShmSize & 0xFFFFFFFF),
+        L"Local\\CamUsageWin.Snapshot");
+    if (!hMap) return false;
+    view = MapViewOfFile(hMap, FILE_MAP_ALL_ACCESS, 0, 0, kShmSize);
+    if (!view) { CloseHandle(hMap); return false; }
+    // The mapping handle stays open for the life of the process.
+#else
+    int fd = shm_open(Shm_Name().c_str(), O_CREAT | O_RDWR | O_CLOEXEC | O_NOFOLLOW, 0600);
+    if (fd < 0) return false;
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_uid != geteuid() ||
+        ((st.st_mode & 0777) != 0600 && fchmod(fd, 0600) != 0) ||
+        ftruncate(fd, static_cast<off_t>(kShmSize)) != 0) {
+        close(fd);
+        return false;
+    }
+    view = mmap(nullptr, kShmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) return false;
+#endif
+    g_shm = static_cast<ShmHeader*>(view);
+    g_shm->layout = kShmLayout;
+    g_shm->capacity = kShmCapacity;
+    g_shm->rowSize = sizeof(ShmRow);
+    g_shm->bufferOffset[0] = kShmBufferOffset;
+    g_shm->bufferOffset[1] = kShmBufferOffset + sizeof(ShmBuffer);
+    std::atomic_thread_fence(std::memory_order_release);
+    g_shm->magic = kShmMagic;
+    return true;
+}
+
+static uint16_t Shm_PutString(char* dst, size_t cap, const std::wstring& s, std::string& scratch) {
+    scratch.clear();
+    AppendUtf8(scratch, s);
+    size_t len = scratch.size();
+    if (len > cap) {
+        len = cap;
+        while (len > 0 && (static_cast<uint8_t>(scratch[len]) & 0xC0) == 0x80) --len;
+    }
+    memcpy(dst, scratch.data(), len);
+    return static_cast<uint16_t>(len);
+}
+
+static void Shm_Publish(const Snapshot& snap) {
+    if (!g_shm) return;
+    uint32_t b = 1 - g_shm->active.load(std::memory_order_relaxed);
+    ShmBuffer* buf = Shm_Buffer(b);
+
+    buf->seq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::string scratch;
+    uint32_t n = static_cast<uint32_t>(std::min<size_t>(snap.rows.size(), kShmCapacity));
+    for (uint32_t i = 0; i < n; ++i) {
+        const CamRow& r = snap.rows[i];
+        ShmRow& d = buf->rows[i];
+        d.kind = r.kind == L"Desktop" ? 1 : 0;
+        d.active = r.activeNow ? 1 : 0;
+        d.startFt = r.startFt;
+        d.stopFt = r.stopFt;
+        d.changedIn = r.changedIn;
+        d.appLen = Shm_PutString(d.app, sizeof(d.app), r.app, scratch);
+        d.exeLen = Shm_PutString(d.exe, sizeof(d.exe), r.exe, scratch);
+        d.capabilityLen = Shm_PutString(d.capability, sizeof(d.capability), r.capability, scratch);
+        d.userLen = Shm_PutString(d.user, sizeof(d.user), r.user, scratch);
+        d.containerLen = Shm_PutString(d.container, sizeof(d.container), r.container, scratch);
+        d.productLen = Shm_PutString(d.product, sizeof(d.product), r.product, scratch);
+        d.companyLen = Shm_PutString(d.company, sizeof(d.company), r.company, scratch);
+        d.versionLen = Shm_PutString(d.version, sizeof(d.version), r.version, scratch);
+        d.sha256Len = Shm_PutString(d.sha256, sizeof(d.sha256), r.sha256, scratch);
+        d.signerLen = Shm_PutString(d.signer, sizeof(d.signer), r.signer, scratch);
+        d.signerIssuerLen = Shm_PutString(d.signerIssuer, sizeof(d.signerIssuer), r.signerIssuer, scratch);
+        d.nameLen = Shm_PutString(d.name, sizeof(d.name), r.name, scratch);
+        d.categoryLen = Shm_PutString(d.category, sizeof(d.category), r.category, scratch);
+        d.policyLen = Shm_PutString(d.policy, sizeof(d.policy), r.policy, scratch);
+    }
+    buf->version = snap.version;
+    buf->rowCount = n;
+    buf->totalRows = static_cast<uint32_t>(snap.rows.size());
+
+    buf->seq.fetch_add(1, std::memory_order_release);
+    g_shm->active.store(b, std::memory_order_release);
+}
+
+// ---------------------- Usage Timeline ----------------------
+// Camera and microphone intervals per app, gathered from the snapshots and
+// downsampled to per-pixel coverage for a timeline strip (--watch
+// --timeline). Coverage is kept at several resolutions: level k holds the
+// covered time per bucket of kTimelineBase << k ticks, so any zoom reads from
+// the level whose buckets are between an eighth and a quarter of a pixel and
+// touches at most nine buckets per pixel; closer in, the sessions are read
+// directly. Buckets are stored in blocks covering the same stretch of time at
+// every level (one bucket at the coarse ones), allocated only where there was
+// activity. History starts with the last session each row
+// reports when first seen and is pruned to kTimelineHistory; other
+// capabilities are not recorded.
+const wchar_t kCapCamera[] = L"webcam";
+const wchar_t kCapMicrophone[] = L"microphone";
+
+constexpr ULONGLONG kTimelineBase = 16 * 60 * kTicksPerSecond;            // level 0 bucket: 16 minutes
+constexpr int kTimelineLevels = 14;                                       // top bucket: about three months
+constexpr ULONGLONG kTimelineHistory = 366 * 24 * 3600 * kTicksPerSecond; // kept history
+constexpr ULONGLONG kTimelinePruneEvery = 24 * 3600 * kTicksPerSecond;
+constexpr int kTimelineUnit = 8; // covered time is counted in ticks >> (level + kTimelineUnit)
+
+// Buckets per block at level k: 64 level-0 buckets' worth, at least one.
+constexpr ULONGLONG Timeline_BlockLen(int k) { return k < 6 ? 64 >> k : 1; }
+
+struct TimelineLevel {
+    std::unordered_map<ULONGLONG, std::vector<uint32_t>> blocks; // block -> covered time per bucket
+};
+
+struct AppTimeline {
+    CamRow id; // the row's IdentityColumns, nothing else
+    std::vector<std::pair<ULONGLONG, ULONGLONG>> sessions; // [start, end), ascending, disjoint
+    ULONGLONG lastStart{ 0 };  // startFt the last session came from
+    ULONGLONG seen{ 0 };       // last snapshot version that had this app
+    bool open{ false };        // last session still running; its end is the last refresh
+    TimelineLevel levels[kTimelineLevels];
+};
+
+struct Timeline {
+    ULONGLONG version{ 0 };
+    ULONGLONG pruned{ 0 };          // when history was last cut to kTimelineHistory
+    std::unordered_map<std::wstring, uint32_t> byKey;
+    std::vector<uint32_t> appOfRow; // snapshot row -> apps index, kNoRow if not recorded
+    std::vector<AppTimeline> apps;
+};
+
+static void Timeline_Cover(AppTimeline& a, ULONGLONG from, ULONGLONG to) {
+    for (int k = 0; k < kTimelineLevels; ++k) {
+        const ULONGLONG size = kTimelineBase << k, len = Timeline_BlockLen(k);
+        for (ULONGLONG t = from; t < to;) {
+            ULONGLONG b = t / size;
+            ULONGLONG end = std::min(to, (b + 1) * size);
+            std::vector<uint32_t>& blk = a.levels[k].blocks[b / len];
+            if (blk.empty()) blk.assign(len, 0);
+            blk[b % len] += static_cast<uint32_t>((end - t) >> (k + kTimelineUnit));
+            t = end;
+        }
+    }
+}
+
+// Extends the app's sessions with what row says at time now.
+static void Timeline_Observe(AppTimeline& a, const CamRow& r, ULONGLONG now) {
+    if (r.startFt == 0) return;
+    if (r.startFt != a.lastStart) {
+        ULONGLONG start = r.startFt;
+        if (!a.sessions.empty()) start = std::max(start, a.sessions.back().second);
+        a.sessions.push_back({ start, start });
+        a.lastStart = r.startFt;
+    }
+    std::pair<ULONGLONG, ULONGLONG>& s = a.sessions.back();
+    ULONGLONG end = r.activeNow ? now : r.stopFt;
+    if (end > s.second) {
+        Timeline_Cover(a, s.second, end);
+        s.second = end;
+    }
+    a.open = r.activeNow;
+}
+
+// Drops sessions and blocks that ended before cutoff, then apps left with
+// no history that the snapshot of version no longer has.
+static void Timeline_Prune(Timeline& tl, ULONGLONG cutoff, ULONGLONG version) {
+    for (AppTimeline& a : tl.apps) {
+        auto keep = std::upper_bound(a.sessions.begin(), a.sessions.end(), cutoff,
+            [](ULONGLONG t, const std::pair<ULONGLONG, ULONGLONG>& s) { return t < s.second; });
+        a.sessions.erase(a.sessions.begin(), keep);
+        for (int k = 0; k < kTimelineLevels; ++k) {
+            const ULONGLONG span = (kTimelineBase << k) * Timeline_BlockLen(k);
+            auto& blocks = a.levels[k].blocks;
+            for (auto it = blocks.begin(); it != blocks.end();) {
+                if ((it->first + 1) * span <= cutoff) it = blocks.erase(it);
+                else ++it;
+            }
+        }
+    }
+    std::vector<uint32_t> moved(tl.apps.size(), kNoRow);
+    size_t n = 0;
+    for (size_t i = 0; i < tl.apps.size(); ++i) {
+        if (tl.apps[i].sessions.empty() && tl.apps[i].seen != version) continue;
+        if (n != i) tl.apps[n] = std::move(tl.apps[i]);
+        moved[i] = static_cast<uint32_t>(n++);
+    }
+    if (n == tl.apps.size()) return;
+    tl.apps.resize(n);
+    for (auto it = tl.byKey.begin(); it != tl.byKey.end();) {
+        if (moved[it->second] == kNoRow) it = tl.byKey.erase(it);
+        else {
+            it->second = moved[it->second];
+            ++it;
+        }
+    }
+    for (uint32_t& id : tl.appOfRow) {
+        if (id != kNoRow) id = moved[id];
+    }
+}
+
+// Records snap into tl. Between consecutive snapshots only new and changed
+// rows and apps with a running session are looked at.
+static void Timeline_Record(Timeline& tl, const Snapshot& snap, ULONGLONG now) {
+    const bool full = snap.version != tl.version + 1;
+    std::vector<uint32_t> appOfRow(snap.rows.size(), kNoRow);
+    for (size_t j = 0; j < snap.rows.size(); ++j) {
+        const CamRow& r = snap.rows[j];
+        uint32_t from = full ? kNoRow : snap.fromPrev[j];
+        uint32_t id;
+        if (from != kNoRow) {
+            id = tl.appOfRow[from];
+            if (id == kNoRow) continue;
+        }
+        else {
+            if (r.capability != kCapCamera && r.capability != kCapMicrophone) continue;
+            auto ins = tl.byKey.emplace(RowKey(r), static_cast<uint32_t>(tl.apps.size()));
+            if (ins.second) {
+                tl.apps.emplace_back();
+                CamRow& idr = tl.apps.back().id;
+                ForEachColumn([&](auto c) { idr.*ColumnAt<c>::field = r.*ColumnAt<c>::field; }, IdentityColumns());
+            }
+            id = ins.first->second;
+        }
+        appOfRow[j] = id;
+        AppTimeline& a = tl.apps[id];
+        a.seen = snap.version;
+        if (from == kNoRow || r.changedIn == snap.version || a.open) Timeline_Observe(a, r, now);
+    }
+    // An app whose row went away while running stops where it was last seen.
+    for (AppTimeline& a : tl.apps) {
+        if (a.open && a.seen != snap.version) a.open = false;
+    }
+    tl.appOfRow.swap(appOfRow);
+    tl.version = snap.version;
+    if (now >= tl.pruned + kTimelinePruneEvery && now > kTimelineHistory) {
+        Timeline_Prune(tl, now - kTimelineHistory, snap.version);
+        tl.pruned = now;
+    }
+}
+
+// Fills out[p] with the covered fraction (0..1) of pixel p, for width pixels
+// spanning [from, to).
+static void Timeline_Render(const AppTimeline& a, ULONGLONG from, ULONGLONG to, unsigned width, std::vector<float>& out) {
+    out.assign(width, 0.0f);
+    if (width == 0 || to <= from) return;
+    const ULONGLONG span = std::max<ULONGLONG>((to - from) / width, 1);
+    auto edge = [&](size_t p) { return p >= width ? to : from + span * p; };
+
+    if (span < 4 * kTimelineBase) {
+        // Zoomed in past the finest level: the sessions in view are few.
+        auto it = std::upper_bound(a.sessions.begin(), a.sessions.end(), std::make_pair(from, ~0ULL));
+        if (it != a.sessions.begin()) --it;
+        for (; it != a.sessions.end() && it->first < to; ++it) {
+            ULONGLONG s = std::max(it->first, from), e = std::min(it->second, to);
+            if (s >= e) continue;
+            for (size_t p = static_cast<size_t>((s - from) / span); p < width && edge(p) < e; ++p) {
+                ULONGLONG ps = std::max(s, edge(p)), pe = std::min(e, edge(p + 1));
+                if (pe > ps) out[p] += static_cast<float>(pe - ps);
+            }
+        }
+    }
+    else {
+        int k = 0;
+        while (k + 1 < kTimelineLevels && (kTimelineBase << (k + 3)) <= span) ++k;
+        const TimelineLevel& lv = a.levels[k];
+        const ULONGLONG size = kTimelineBase << k, len = Timeline_BlockLen(k);
+        ULONGLONG blockNo = ~0ULL;
+        const std::vector<uint32_t>* blk = nullptr;
+        for (size_t p = 0; p < width; ++p) {
+            const ULONGLONG ps = edge(p), pe = edge(p + 1);
+            double covered = 0;
+            for (ULONGLONG b = ps / size; b * size < pe; ++b) {
+                if (b / len != blockNo) {
+                    blockNo = b / len;
+                    auto it = lv.blocks.find(blockNo);
+                    blk = it != lv.blocks.end() ? &it->second : nullptr;
+                }
+                if (!blk) continue;
+                ULONGLONG c = static_cast<ULONGLONG>((*blk)[b % len]) << (k + kTimelineUnit);
+                if (c == 0) continue;
+                // Partial buckets are assumed evenly covered.
+                ULONGLONG overlap = std::min(pe, (b + 1) * size) - std::max(ps, b * size);
+                covered += static_cast<double>(c) * overlap / size;
+            }
+            out[p] = static_cast<float>(covered);
+        }
+    }
+    for (size_t p = 0; p < width; ++p) out[p] /= static_cast<float>(edge(p + 1) - edge(p));
+}
+
+// ---------------------- Session Correlation -----------------
+// Finds when one app had two capabilities in use at once (camera and
+// microphone, say). Each side is a list of [start, end) intervals tagged with
+// an app id; both are sorted by (app, start) and merged within an app, and a
+// merge-join then walks them together in linear time, emitting the
+// intersections. The same join runs on the live snapshot (each row's last
+// session) and on the timeline's recorded history.
+struct AppInterval {
+    uint32_t  app;   // AppIds index
+    ULONGLONG start; // FILETIME ticks
+    ULONGLONG end;   // exclusive
+};
+
+// Apps across capabilities: rows that differ only in capability share an id.
+struct AppIds {
+    std::unordered_map<std::wstring, uint32_t> byKey;
+    std::vector<CamRow> apps; // identity fields only
+};
+
+static uint32_t AppIds_Get(AppIds& ids, const CamRow& r) {
+    auto ins = ids.byKey.emplace(AppKey(r), static_cast<uint32_t>(ids.apps.size()));
+    if (ins.second) {
+        CamRow id;
+        ForEachColumn([&](auto c) { id.*ColumnAt<c>::field = r.*ColumnAt<c>::field; }, AppColumns());
+        ids.apps.push_back(std::move(id));
+    }
+    return ins.first->second;
+}
+
+// Sorts v by (app, start) and merges overlapping or touching intervals of the
+// same app, dropping empty ones.
+static void Correlate_Normalize(std::vector<AppInterval>& v) {
+    std::sort(v.begin(), v.end(), [](const AppInterval& a, const AppInterval& b) {
+        return a.app != b.app ? a.app < b.app : a.start < b.start;
+        });
+    size_t n = 0;
+    for (const AppInterval& x : v) {
+        if (x.end <= x.start) continue;
+        if (n > 0 && v[n - 1].app == x.app && x.start <= v[n - 1].end) v[n - 1].end = std::max(v[n - 1].end, x.end);
+        else v[n++] = x;
+    }
+    v.resize(n);
+}
+
+// Appends to out the intervals where an app is in both a and b. Both inputs
+// must be normalized; the output is normalized too.
+static void Correlate_Join(const std::vector<AppInterval>& a, const std::vector<AppInterval>& b,
+    std::vector<AppInterval>& out) {
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        const AppInterval& x = a[i];
+        const AppInterval& y = b[j];
+        if (x.app != y.app) {
+            (x.app < y.app ? i : j)++;
+            continue;
+        }
+        ULONGLONG s = std::max(x.start, y.start), e = std::min(x.end, y.end);
+        if (s < e) out.push_back({ x.app, s, e });
+        // The interval that ends first cannot meet anything further on the other side.
+        (x.end < y.end ? i : j)++;
+    }
+}
+
+// The last session of every row of capability; a running one ends at now.
+static void Correlate_FromSnapshot(const Snapshot& snap, const wchar_t* capability, ULONGLONG now,
+    AppIds& ids, std::vector<AppInterval>& out) {
+    out.clear();
+    for (const CamRow& r : snap.rows) {
+        if (r.startFt == 0 || r.capability != capability) continue;
+        out.push_back({ AppIds_Get(ids, r), r.startFt, r.activeNow ? now : r.stopFt });
+    }
+    Correlate_Normalize(out);
+}
+
+// Every recorded session of capability; a running one ends at the last refresh.
+static void Correlate_FromTimeline(const Timeline& tl, const wchar_t* capability,
+    AppIds& ids, std::vector<AppInterval>& out) {
+    out.clear();
+    for (const AppTimeline& a : tl.apps) {
+        if (a.sessions.empty() || a.id.capability != capability) continue;
+        uint32_t id = AppIds_Get(ids, a.id);
+        for (const auto& s : a.sessions) out.push_back({ id, s.first, s.second });
+    }
+    Correlate_Normalize(out);
+}
+
+// Camera and microphone on together, per app, in the live snapshot and in
+// the recorded history.
+struct AvOverlap {
+    AppIds ids;
+    std::vector<AppInterval> camera, microphone;
+    std::vector<AppInterval> live;    // last sessions that overlapped
+    std::vector<AppInterval> history; // all recorded overlap
+};
+
+static void Correlate_CameraMicrophone(AvOverlap& av, const Snapshot& snap, const Timeline& tl, ULONGLONG now) {
+    av.live.clear();
+    av.history.clear();
+    Correlate_FromSnapshot(snap, kCapCamera, now, av.ids, av.camera);
+    Correlate_FromSnapshot(snap, kCapMicrophone, now, av.ids, av.microphone);
+    Correlate_Join(av.camera, av.microphone, av.live);
+    Correlate_FromTimeline(tl, kCapCamera, av.ids, av.camera);
+    Correlate_FromTimeline(tl, kCapMicrophone, av.ids, av.microphone);
+    Correlate_Join(av.camera, av.microphone, av.history);
+}
+
+// ---------------------- SHA-256 -----------------------------
+// FIPS 180-4 SHA-256 for the exe hashes. The block function is chosen once:
+// the SHA extensions on x86 CPUs that have them (two rounds per
+// instruction), the portable one otherwise.
+struct Sha256 {
+    uint32_t  h[8];
+    ULONGLONG bytes{ 0 };
+    uint8_t   block[64];
+    size_t    used{ 0 };
+};
+
+alignas(16) const uint32_t kSha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static uint32_t Sha256_Rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static void Sha256_BlocksPortable(uint32_t h[8], const uint8_t* p, size_t blocks) {
+    for (; blocks--; p += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(p[i * 4]) << 24) | (uint32_t(p[i * 4 + 1]) << 16) | (uint32_t(p[i * 4 + 2]) << 8) | p[i * 4 + 3];
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = Sha256_Rotr(w[i - 15], 7) ^ Sha256_Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = Sha256_Rotr(w[i - 2], 17) ^ Sha256_Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = k + (Sha256_Rotr(e, 6) ^ Sha256_Rotr(e, 11) ^ Sha256_Rotr(e, 25)) + ((e & f) ^ (~e & g)) + kSha256K[i] + w[i];
+            uint32_t t2 = (Sha256_Rotr(a, 2) ^ Sha256_Rotr(a, 13) ^ Sha256_Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            k = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+    }
+}
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CAMUSAGE_SHA_X86 1
+#if defined(__GNUC__) || defined(__clang__)
+#define CAMUSAGE_SHA_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#else
+#define CAMUSAGE_SHA_TARGET
+#endif
+
+// The state is kept as ABEF/CDGH lane pairs, the order sha256rnds2 wants;
+// each group of four rounds also extends the message schedule four words.
+CAMUSAGE_SHA_TARGET
+static void Sha256_BlocksShaNi(uint32_t h[8], const uint8_t* p, size_t blocks) {
+    const __m128i swap = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h)), 0xB1);
+    __m128i s1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h + 4)), 0x1B);
+    __m128i s0 = _mm_alignr_epi8(tmp, s1, 8);
+    s1 = _mm_blend_epi16(s1, tmp, 0xF0);
+    for (; blocks--; p += 64) {
+        const __m128i abef = s0, cdgh = s1;
+        __m128i m[4];
+        for (int i = 0; i < 16; ++i) {
+            if (i < 4) m[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16)), swap);
+            __m128i msg = _mm_add_epi32(m[i & 3], _mm_load_si128(reinterpret_cast<const __m128i*>(kSha256K + i * 4)));
+            s1 = _mm_sha256rnds2_epu32(s1, s0, msg);
+            if (i >= 3 && i < 15) {
+                __m128i& next = m[(i + 1) & 3];
+                next = _mm_sha256msg2_epu32(_mm_add_epi32(next, _mm_alignr_epi8(m[i & 3], m[(i + 3) & 3], 4)), m[i & 3]);
+            }
+            s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(msg, 0x0E));
+            if (i >= 1 && i < 13) m[(i + 3) & 3] = _mm_sha256msg1_epu32(m[(i + 3) & 3], m[i & 3]);
+        }
+        s0 = _mm_add_epi32(s0, abef);
+        s1 = _mm_add_epi32(s1, cdgh);
+    }
+    tmp = _mm_shuffle_epi32(s0, 0x1B);
+    s1 = _mm_shuffle_epi32(s1, 0xB1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(h), _mm_blend_epi16(tmp, s1, 0xF0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(h + 4), _mm_alignr_epi8(s1, tmp, 8));
+}
+
+static bool Sha256_HaveShaNi() {
+    unsigned r1[4]{}, r7[4]{};
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7) return false;
+    __cpuid(regs, 1);
+    memcpy(r1, regs, sizeof(r1));
+    __cpuidex(regs, 7, 0);
+    memcpy(r7, regs, sizeof(r7));
+#else
+    if (!__get_cpuid(1, &r1[0], &r1[1], &r1[2], &r1[3]) || !__get_cpuid_count(7, 0, &r7[0], &r7[1], &r7[2], &r7[3])) return false;
+#endif
+    const bool ssse3 = r1[2] & (1u << 9), sse41 = r1[2] & (1u << 19), sha = r7[1] & (1u << 29);
+    return ssse3 && sse41 && sha;
+}
+#endif
+
+typedef void (*Sha256BlocksFn)(uint32_t h[8], const uint8_t* p, size_t blocks);
+
+static Sha256BlocksFn Sha256_PickBlocks() {
+#ifdef CAMUSAGE_SHA_X86
+    if (Sha256_HaveShaNi()) return Sha256_BlocksShaNi;
+#endif
+    return Sha256_BlocksPortable;
+}
+
+static const Sha256BlocksFn g_sha256Blocks = Sha256_PickBlocks();
+
+static void Sha256_Init(Sha256& s) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    memcpy(s.h, iv, sizeof(iv));
+    s.bytes = 0;
+    s.used = 0;
+}
+
+static void Sha256_Update(Sha256& s, const uint8_t* p, size_t n) {
+    s.bytes += n;
+    if (s.used) {
+        size_t take = std::min(n, 64 - s.used);
+        memcpy(s.block + s.used, p, take);
+        s.used += take;
+        p += take;
+        n -= take;
+        if (s.used < 64) return;
+        g_sha256Blocks(s.h, s.block, 1);
+        s.used = 0;
+    }
+    g_sha256Blocks(s.h, p, n / 64);
+    memcpy(s.block, p + (n & ~size_t(63)), n & 63);
+    s.used = n & 63;
+}
+
+static void Sha256_Final(Sha256& s, uint8_t out[32]) {
+    const ULONGLONG bits = s.bytes * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t padLen = (s.used < 56 ? 56 : 120) - s.used;
+    for (int i = 0; i < 8; ++i) pad[padLen + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    Sha256_Update(s, pad, padLen + 8);
+    for (int i = 0; i < 8; ++i) {
+        for (int b = 0; b < 4; ++b) out[i * 4 + b] = static_cast<uint8_t>(s.h[i] >> (24 - 8 * b));
+    }
+}
+
+// ---------------------- Executable Metadata -----------------
+// Product, company and file version of the exe behind each row, read from its
+// VS_VERSIONINFO resource, and who signed it. The file is mapped read-only and
+// the resource directory walked straight to RT_VERSION; the image is never
+// loaded, so the same code reads binaries collected from other machines on
+// any host (see --inspect in the portable build). Every offset read from the
+// file is bounds-checked against the mapping. Results are cached per path and
+// the file is parsed again only when its size or mtime changes.
+struct FileStamp {
+    ULONGLONG size{ 0 };
+    ULONGLONG mtime{ 0 }; // FILETIME ticks
+    bool operator==(const FileStamp& o) const { return size == o.size && mtime == o.mtime; }
+};
+
+struct ExeInfo {
+    FileStamp    stamp;
+    bool         seen{ false }; // referenced by the current refresh
+    bool         hashed{ false };
+    std::wstring product, company, version, sha256;
+    std::wstring signer, signerIssuer; // Authenticode, empty if unsigned
+};
+
+// Read-only view of a whole file.
+struct MappedFile {
+    const uint8_t* data{ nullptr };
+    size_t size{ 0 };
+};
+
+static bool File_Stamp(const std::wstring& path, FileStamp& out) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA fa{};
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &fa)) return false;
+    if (fa.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) return false;
+    out.size = (static_cast<ULONGLONG>(fa.nFileSizeHigh) << 32) | fa.nFileSizeLow;
+    out.mtime = (static_cast<ULONGLONG>(fa.ftLastWriteTime.dwHighDateTime) << 32) | fa.ftLastWriteTime.dwLowDateTime;
+#else
+    std::string p;
+    AppendUtf8(p, path);
+    struct stat st {};
+    if (stat(p.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    out.size = static_cast<ULONGLONG>(st.st_size);
+    out.mtime = 116444736000000000ULL + static_cast<ULONGLONG>(st.st_mtime) * kTicksPerSecond;
+#ifdef __linux__
+    out.mtime += static_cast<ULONGLONG>(st.st_mtim.tv_nsec) / 100;
+#endif
+#endif
+    return true;
+}
+
+static bool Map_Open(const std::wstring& path, MappedFile& m) {
+#ifdef _WIN32
+    HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size{};
+    HANDLE hMap = nullptr;
+    if (GetFileSizeEx(hFile, &size) && size.QuadPart > 0 && static_cast<ULONGLONG>(size.QuadPart) <= SIZE_MAX) {
+        hMap = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    CloseHandle(hFile);
+    if (!hMap) return false;
+    void* view = MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMap); // the view keeps the mapping alive
+    if (!view) return false;
+    m.data = static_cast<const uint8_t*>(view);
+    m.size = static_cast<size_t>(size.QuadPart);
+#else
+    std::string p;
+    AppendUtf8(p, path);
+    int fd = open(p.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st {};
+    void* view = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (view == MAP_FAILED) return false;
+    m.data = static_cast<const uint8_t*>(view);
+    m.size = static_cast<size_t>(st.st_size);
+#endif
+    return true;
+}
+
+static void Map_Close(MappedFile& m) {
+    if (!m.data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m.data);
+#else
+    munmap(const_cast<uint8_t*>(m.data), m.size);
+#endif
+    m.data = nullptr;
+    m.size = 0;
+}
+
+// Headers of a PE file, located and bounds-checked by Pe_Open.
+struct PeImage {
+    const uint8_t* data{ nullptr };
+    size_t size{ 0 };
+    const uint8_t* dirs{ nullptr };     // IMAGE_DATA_DIRECTORY[dirCount]
+    uint32_t dirCount{ 0 };
+    const uint8_t* sections{ nullptr }; // IMAGE_SECTION_HEADER[sectionCount]
+    uint32_t sectionCount{ 0 };
+};
+
+const uint32_t kPeDirResource = 2;
+const uint32_t kResourceVersion = 16; // RT_VERSION
+const uint32_t kResourceSubdir = 0x80000000;
+const uint32_t kVersionSignature = 0xFEEF04BD;
+
+static bool Pe_Open(const uint8_t* data, size_t size, PeImage& pe) {
+    if (size < 0x40 || data[0] != 'M' || data[1] != 'Z') return false;
+    const size_t nt = static_cast<size_t>(GetLE(data + 0x3C, 4));
+    if (nt > size || size - nt < 24 || memcmp(data + nt, "PE\0\0", 4) != 0) return false;
+    const uint8_t* coff = data + nt + 4;
+    const uint32_t sections = static_cast<uint32_t>(GetLE(coff + 2, 2));
+    const size_t optAt = nt + 24, optSize = static_cast<size_t>(GetLE(coff + 16, 2));
+    if (size - optAt < optSize || optSize < 2) return false;
+    // Data directories follow the PE32 / PE32+ specific fields.
+    const uint32_t magic = static_cast<uint32_t>(GetLE(data + optAt, 2));
+    const size_t dirsAt = magic == 0x10B ? 96 : magic == 0x20B ? 112 : 0;
+    if (dirsAt == 0 || optSize < dirsAt) return false;
+    pe.data = data;
+    pe.size = size;
+    pe.dirs = data + optAt + dirsAt;
+    pe.dirCount = static_cast<uint32_t>(std::min<ULONGLONG>(GetLE(data + optAt + dirsAt - 4, 4), (optSize - dirsAt) / 8));
+    const size_t sectionsAt = optAt + optSize;
+    if ((size - sectionsAt) / 40 < sections) return false;
+    pe.sections = data + sectionsAt;
+    pe.sectionCount = sections;
+    return true;
+}
+
+// Data directory i as an (RVA, size) pair; false if the image has none.
+static bool Pe_Directory(const PeImage& pe, uint32_t i, uint32_t& rva, uint32_t& len) {
+    if (i >= pe.dirCount) return false;
+    rva = static_cast<uint32_t>(GetLE(pe.dirs + i * 8, 4));
+    len = static_cast<uint32_t>(GetLE(pe.dirs + i * 8 + 4, 4));
+    return rva != 0 && len != 0;
+}
+
+// File bytes backing [rva, rva + len), which must lie in one section's raw data.
+static const uint8_t* Pe_At(const PeImage& pe, uint32_t rva, uint32_t len) {
+    for (uint32_t i = 0; i < pe.sectionCount; ++i) {
+        const uint8_t* s = pe.sections + i * 40;
+        const ULONGLONG va = GetLE(s + 12, 4), rawSize = GetLE(s + 16, 4), rawAt = GetLE(s + 20, 4);
+        if (rva < va || rva - va >= rawSize) continue;
+        const ULONGLONG at = rawAt + (rva - va);
+        if (rva - va + len > rawSize || at + len > pe.size) return nullptr;
+        return pe.data + at;
+    }
+    return nullptr;
+}
+
+// Target of the entry with the given id in the resource directory at dir
+// (an offset into the resource section), or of its first entry when any.
+static bool Pe_ResourceEntry(const uint8_t* rsrc, uint32_t len, uint32_t dir, uint32_t id, bool any, uint32_t& target) {
+    if (dir > len || len - dir < 16) return false;
+    const uint32_t n = static_cast<uint32_t>(GetLE(rsrc + dir + 12, 2) + GetLE(rsrc + dir + 14, 2));
+    if ((len - dir - 16) / 8 < n) return false;
+    for (uint32_t i = 0; i < n; ++i) {
+        const uint8_t* e = rsrc + dir + 16 + i * 8;
+        if (any || GetLE(e, 4) == id) {
+            target = static_cast<uint32_t>(GetLE(e + 4, 4));
+            return true;
+        }
+    }
+    return false;
+}
+
+// The VS_VERSIONINFO resource: type RT_VERSION, then the first name and the
+// first language under it.
+static const uint8_t* Pe_VersionResource(const PeImage& pe, uint32_t& size) {
+    uint32_t rva = 0, len = 0;
+    if (!Pe_Directory(pe, kPeDirResource, rva, len)) return nullptr;
+    const uint8_t* rsrc = Pe_At(pe, rva, len);
+    uint32_t name = 0, lang = 0, leaf = 0;
+    if (!rsrc ||
+        !Pe_ResourceEntry(rsrc, len, 0, kResourceVersion, false, name) || !(name & kResourceSubdir) ||
+        !Pe_ResourceEntry(rsrc, len, name & ~kResourceSubdir, 0, true, lang) || !(lang & kResourceSubdir) ||
+        !Pe_ResourceEntry(rsrc, len, lang & ~kResourceSubdir, 0, true, leaf) || (leaf & kResourceSubdir) ||
+        leaf > len || len - leaf < 16) return nullptr;
+    size = static_cast<uint32_t>(GetLE(rsrc + leaf + 4, 4));
+    return Pe_At(pe, static_cast<uint32_t>(GetLE(rsrc + leaf, 4)), size);
+}
+
+// UTF-16 text (up to a NUL) appended as wchar_t, pairing surrogates where
+// wchar_t is 32-bit.
+static void AppendUtf16(std::wstring& out, const uint8_t* p, size_t units, bool bigEndian) {
+    auto unit = [&](size_t i) { return bigEndian ? (uint32_t(p[i * 2]) << 8) | p[i * 2 + 1] : static_cast<uint32_t>(GetLE(p + i * 2, 2)); };
+    for (size_t i = 0; i < units; ++i) {
+        uint32_t c = unit(i);
+        if (c == 0) break;
+        if (sizeof(wchar_t) == 4 && c >= 0xD800 && c <= 0xDBFF && i + 1 < units) {
+            const uint32_t lo = unit(i + 1);
+            if (lo >= 0xDC00 && lo <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (lo - 0xDC00);
+                ++i;
+            }
+        }
+        out += static_cast<wchar_t>(c);
+    }
+}
+
+// One block of a VS_VERSIONINFO tree. Offsets are from the start of the
+// resource, which is 32-bit aligned like the blocks inside it.
+struct VerBlock {
+    size_t keyAt, keyUnits; // UTF-16 key
+    size_t valueAt, valueBytes;
+    size_t childAt, end;
+};
+
+static size_t Ver_Align(size_t at) { return (at + 3) & ~size_t(3); }
+
+static bool Ver_Block(const uint8_t* p, size_t size, size_t at, VerBlock& b) {
+    if (at > size || size - at < 6) return false;
+    const size_t len = static_cast<size_t>(GetLE(p + at, 2));
+    if (len < 6 || len > size - at) return false;
+    b.end = at + len;
+    b.keyAt = at + 6;
+    size_t i = b.keyAt;
+    while (i + 2 <= b.end && GetLE(p + i, 2) != 0) i += 2;
+    if (i + 2 > b.end) return false;
+    b.keyUnits = (i - b.keyAt) / 2;
+    // wValueLength counts characters for text values and bytes otherwise;
+    // some linkers get it wrong, so it is clamped to the block.
+    const size_t valueLen = static_cast<size_t>(GetLE(p + at + 2, 2));
+    const bool text = GetLE(p + at + 4, 2) == 1;
+    b.valueAt = std::min(Ver_Align(i + 2), b.end);
+    b.valueBytes = std::min(text ? valueLen * 2 : valueLen, b.end - b.valueAt);
+    b.childAt = std::min(Ver_Align(b.valueAt + b.valueBytes), b.end);
+    return true;
+}
+
+static bool Ver_KeyIs(const uint8_t* p, const VerBlock& b, const char* key) {
+    size_t n = strlen(key);
+    if (b.keyUnits != n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (GetLE(p + b.keyAt + i * 2, 2) != static_cast<uint8_t>(key[i])) return false;
+    }
+    return true;
+}
+
+// Calls f(block) for each child of parent.
+template <typename F>
+static void Ver_ForEachChild(const uint8_t* p, const VerBlock& parent, F&& f) {
+    VerBlock b{};
+    for (size_t at = parent.childAt; at < parent.end && Ver_Block(p, parent.end, at, b); at = Ver_Align(b.end)) f(b);
+}
+
+// Fills info from a VS_VERSIONINFO resource. The numeric file version from
+// VS_FIXEDFILEINFO is preferred over the free-form FileVersion string.
+static bool Ver_Parse(const uint8_t* p, size_t size, ExeInfo& info) {
+    VerBlock root{};
+    if (!Ver_Block(p, size, 0, root) || !Ver_KeyIs(p, root, "VS_VERSION_INFO")) return false;
+    if (root.valueBytes >= 52 && GetLE(p + root.valueAt, 4) == kVersionSignature) {
+        const uint32_t ms = static_cast<uint32_t>(GetLE(p + root.valueAt + 8, 4));
+        const uint32_t ls = static_cast<uint32_t>(GetLE(p + root.valueAt + 12, 4));
+        info.version = std::to_wstring(ms >> 16) + L'.' + std::to_wstring(ms & 0xFFFF) + L'.' +
+            std::to_wstring(ls >> 16) + L'.' + std::to_wstring(ls & 0xFFFF);
+    }
+    std::wstring fileVersion;
+    Ver_ForEachChild(p, root, [&](const VerBlock& sfi) {
+        if (!Ver_KeyIs(p, sfi, "StringFileInfo")) return;
+        // One StringTable per language; the first one to name a field wins.
+        Ver_ForEachChild(p, sfi, [&](const VerBlock& table) {
+            Ver_ForEachChild(p, table, [&](const VerBlock& s) {
+                std::wstring* field = Ver_KeyIs(p, s, "ProductName") ? &info.product :
+                    Ver_KeyIs(p, s, "CompanyName") ? &info.company :
+                    Ver_KeyIs(p, s, "FileVersion") ? &fileVersion : nullptr;
+                if (field && field->empty()) AppendUtf16(*field, p + s.valueAt, s.valueBytes / 2, false);
+            });
+        });
+    });
+    if (info.version.empty()) info.version = fileVersion;
+    return true;
+}
+
+// Authenticode: the certificate table (data directory 4, whose address is a
+// file offset rather than an RVA) holds WIN_CERTIFICATE entries; the first
+// PKCS#7 SignedData one is the signature. Only the TLV structure is walked,
+// nothing is verified: the signer is the certificate whose issuer and serial
+// number match the first SignerInfo, and its subject and issuer common names
+// (or organizations) are reported.
+const uint32_t kPeDirSecurity = 4;
+const uint32_t kWinCertPkcsSignedData = 2;
+const uint8_t kOidSignedData[] = { 0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02 }; // 1.2.840.113549.1.7.2
+const uint8_t kOidCommonName[] = { 0x55, 0x04, 0x03 };                                   // 2.5.4.3
+const uint8_t kOidOrganization[] = { 0x55, 0x04, 0x0A };                                 // 2.5.4.10
+
+// One DER element: tag, the whole encoding and the contents.
+struct DerItem {
+    uint8_t tag{ 0 };
+    const uint8_t* at{ nullptr };  // first byte of the tag
+    const uint8_t* value{ nullptr };
+    const uint8_t* end{ nullptr }; // one past the contents
+};
+
+// Reads the element at p (before end) and advances p past it. Indefinite
+// lengths (BER, seen in some old signatures) extend to end.
+static bool Der_Next(const uint8_t*& p, const uint8_t* end, DerItem& item) {
+    if (end - p < 2 || (p[0] & 0x1F) == 0x1F) return false; // multi-byte tags are not used here
+    item.tag = p[0];
+    item.at = p;
+    size_t len = p[1];
+    const uint8_t* v = p + 2;
+    if (len == 0x80) {
+        len = static_cast<size_t>(end - v);
+    }
+    else if (len > 0x80) {
+        size_t bytes = len & 0x7F;
+        if (bytes > 4 || static_cast<size_t>(end - v) < bytes) return false;
+        len = 0;
+        for (size_t i = 0; i < bytes; ++i) len = (len << 8) | *v++;
+    }
+    if (static_cast<size_t>(end - v) < len) return false;
+    item.value = v;
+    item.end = v + len;
+    p = item.end;
+    return true;
+}
+
+// The index-th child of a constructed element (0 is the first).
+static bool Der_Child(const DerItem& parent, size_t index, DerItem& child) {
+    const uint8_t* p = parent.value;
+    for (size_t i = 0; i <= index; ++i) {
+        if (!Der_Next(p, parent.end, child) || child.tag == 0) return false; // 0: end-of-contents
+    }
+    return true;
+}
+
+static bool Der_Equal(const DerItem& a, const DerItem& b) {
+    return a.end - a.at == b.end - b.at && memcmp(a.at, b.at, static_cast<size_t>(a.end - a.at)) == 0;
+}
+
+static bool Der_IsOid(const DerItem& item, const uint8_t* oid, size_t len) {
+    return item.tag == 0x06 && static_cast<size_t>(item.end - item.value) == len && memcmp(item.value, oid, len) == 0;
+}
+
+// Text of a directory string: UTF8String, PrintableString, IA5String,
+// TeletexString (read as UTF-8, as issuers use it) or BMPString.
+static std::wstring Der_Text(const DerItem& s) {
+    std::wstring out;
+    const size_t n = static_cast<size_t>(s.end - s.value);
+    if (s.tag == 0x1E) AppendUtf16(out, s.value, n / 2, true);
+    else if (s.tag == 0x0C || s.tag == 0x13 || s.tag == 0x16 || s.tag == 0x14) {
+        AppendWide(out, std::string_view(reinterpret_cast<const char*>(s.value), n));
+    }
+    return out;
+}
+
+// CN of an X.501 Name, or O when it has none.
+static std::wstring Der_NameText(const DerItem& name) {
+    std::wstring cn, org;
+    DerItem rdn{}, atv{}, type{}, value{};
+    for (size_t i = 0; Der_Child(name, i, rdn); ++i) {
+        for (size_t j = 0; Der_Child(rdn, j, atv); ++j) {
+            if (!Der_Child(atv, 0, type) || !Der_Child(atv, 1, value)) continue;
+            if (cn.empty() && Der_IsOid(type, kOidCommonName, sizeof(kOidCommonName))) cn = Der_Text(value);
+            else if (org.empty() && Der_IsOid(type, kOidOrganization, sizeof(kOidOrganization))) org = Der_Text(value);
+        }
+    }
+    return cn.empty() ? org : cn;
+}
+
+// Issuer, serial number and subject of an X.509 certificate.
+static bool Der_CertNames(const DerItem& cert, DerItem& issuer, DerItem& serial, DerItem& subject) {
+    DerItem tbs{};
+    if (!Der_Child(cert, 0, tbs) || tbs.tag != 0x30) return false;
+    DerItem first{};
+    if (!Der_Child(tbs, 0, first)) return false;
+    const size_t base = first.tag == 0xA0 ? 1 : 0; // optional [0] version
+    return Der_Child(tbs, base, serial) && serial.tag == 0x02 &&
+        Der_Child(tbs, base + 2, issuer) && issuer.tag == 0x30 &&
+        Der_Child(tbs, base + 4, subject) && subject.tag == 0x30;
+}
+
+// Signer subject and issuer from a PKCS#7 SignedData ContentInfo.
+static bool Sig_ParsePkcs7(const uint8_t* p, size_t size, ExeInfo& info) {
+    const uint8_t* at = p;
+    DerItem contentInfo{}, type{}, wrapper{}, signedData{};
+    if (!Der_Next(at, p + size, contentInfo) || contentInfo.tag != 0x30 ||
+        !Der_Child(contentInfo, 0, type) || !Der_IsOid(type, kOidSignedData, sizeof(kOidSignedData)) ||
+        !Der_Child(contentInfo, 1, wrapper) || wrapper.tag != 0xA0 ||
+        !Der_Child(wrapper, 0, signedData) || signedData.tag != 0x30) return false;
+
+    // SignedData: version, digestAlgorithms, contentInfo, [0] certificates,
+    // [1] crls, signerInfos.
+    DerItem certs{}, signerInfos{}, item{};
+    for (size_t i = 3; Der_Child(signedData, i, item); ++i) {
+        if (item.tag == 0xA0) certs = item;
+        else if (item.tag == 0x31) signerInfos = item;
+    }
+    DerItem signer{}, sid{}, sidIssuer{}, sidSerial{};
+    if (!certs.at || !signerInfos.at || !Der_Child(signerInfos, 0, signer) ||
+        !Der_Child(signer, 1, sid)) return false;
+    const bool bySerial = sid.tag == 0x30 && Der_Child(sid, 0, sidIssuer) && Der_Child(sid, 1, sidSerial);
+
+    // The signer's certificate; the first one if the SignerInfo names it by
+    // key identifier, which is not matched here.
+    DerItem cert{}, issuer{}, serial{}, subject{};
+    bool found = false;
+    for (size_t i = 0; !found && Der_Child(certs, i, cert); ++i) {
+        if (!Der_CertNames(cert, issuer, serial, subject)) continue;
+        found = !bySerial || (Der_Equal(issuer, sidIssuer) && Der_Equal(serial, sidSerial));
+    }
+    if (!found) return false;
+    info.signer = Der_NameText(subject);
+    info.signerIssuer = Der_NameText(issuer);
+    return true;
+}
+
+// Walks the certificate table for the Authenticode signature.
+static bool Sig_Read(const PeImage& pe, ExeInfo& info) {
+    uint32_t offset = 0, len = 0;
+    if (!Pe_Directory(pe, kPeDirSecurity, offset, len) || offset > pe.size || pe.size - offset < len) return false;
+    const uint8_t* p = pe.data + offset;
+    // WIN_CERTIFICATE: u32 dwLength, u16 wRevision, u16 wCertificateType,
+    // then the certificate; entries are 8-byte aligned.
+    for (size_t at = 0; len - at >= 8;) {
+        const size_t certLen = static_cast<size_t>(GetLE(p + at, 4));
+        if (certLen < 8 || certLen > len - at) return false;
+        if (GetLE(p + at + 6, 2) == kWinCertPkcsSignedData) return Sig_ParsePkcs7(p + at + 8, certLen - 8, info);
+        at += (certLen + 7) & ~size_t(7);
+        if (at > len) return false;
+    }
+    return false;
+}
+
+// Version fields and signer of the PE file at path, from one mapping; false
+// if it cannot be read or is not a PE file.
+static bool Exe_Read(const std::wstring& path, ExeInfo& info) {
+    MappedFile m;
+    if (!Map_Open(path, m)) return false;
+    PeImage pe;
+    bool ok = Pe_Open(m.data, m.size, pe);
+    if (ok) {
+        uint32_t size = 0;
+        if (const uint8_t* res = Pe_VersionResource(pe, size)) Ver_Parse(res, size, info);
+        Sig_Read(pe, info);
+    }
+    Map_Close(m);
+    return ok;
+}
+
+// SHA-256 of every Desktop row's exe, for matching against threat intel.
+// Files are hashed on a thread pool, largest first, with 1 MiB sequential
+// reads into page-aligned buffers (unbuffered on Windows, so hashing a large
+// binary does not evict the cache). Hashes are also kept on disk, keyed by
+// file ID (volume and file index, or device and inode), size and mtime, so a
+// later run only reads binaries that are new or changed. The cache file is
+// a 16-byte header followed by 64-byte records:
+//   u64 volume, u64 file, u64 size, u64 mtime, u8 sha256[32]  (little-endian)
+const size_t kHashChunk = 1 << 20;
+const unsigned kHashThreadsMax = 8;
+const uint32_t kHashCacheMagic = 0x48534143; // "CASH"
+const uint32_t kHashCacheLayout = 1;
+const size_t kHashRecord = 64;
+
+struct HashRecord {
+    ULONGLONG size{ 0 }, mtime{ 0 };
+    uint8_t   sha256[32]{};
+};
+
+// By (volume, file index). Read by the hashing threads, written between runs
+// of the pool by the thread running Hash_Run (one at a time: the background
+// job, or --inspect).
+static std::map<std::pair<ULONGLONG, ULONGLONG>, HashRecord> g_hashCache;
+static std::atomic<bool> g_hashStop{ false }; // exiting: Hash_File gives up between chunks
+static std::wstring g_hashCachePath; // --hash-cache; default from Hash_DefaultCachePath
+static bool g_hashCacheLoaded = false;
+
+static std::wstring Hash_DefaultCachePath() {
+#ifdef _WIN32
+    wchar_t dir[MAX_PATH];
+    DWORD n = GetEnvironmentVariableW(L"LOCALAPPDATA", dir, MAX_PATH);
+    if (n == 0 || n >= MAX_PATH) return L"";
+    std::wstring path = dir;
+    path += L"\\CamUsageWin";
+    CreateDirectoryW(path.c_str(), nullptr);
+    return path + L"\\sha256.cache";
+#else
+    std::wstring path;
+    if (const char* xdg = getenv("XDG_CACHE_HOME")) AppendWide(path, xdg);
+    else if (const char* home = getenv("HOME")) {
+        AppendWide(path, home);
+        path += L"/.cache";
+    }
+    else return L"";
+    std::string dir;
+    AppendUtf8(dir, path);
+    mkdir(dir.c_str(), 0700);
+    return path + L"/camusage.sha256";
+#endif
+}
+
+static FILE* File_Open(const std::wstring& path, bool write) {
+#ifdef _WIN32
+    return _wfopen(path.c_str(), write ? L"wb" : L"rb");
+#else
+    std::string p;
+    AppendUtf8(p, path);
+    return fopen(p.c_str(), write ? "wb" : "rb");
+#endif
+}
+
+static void Hash_LoadCache() {
+    g_hashCacheLoaded = true;
+    if (g_hashCachePath.empty()) g_hashCachePath = Hash_DefaultCachePath();
+    FILE* f = g_hashCachePath.empty() ? nullptr : File_Open(g_hashCachePath, false);
+    if (!f) return;
+    uint8_t rec[kHashRecord];
+    if (fread(rec, 1, 16, f) == 16 && GetLE(rec, 4) == kHashCacheMagic && GetLE(rec + 4, 4) == kHashCacheLayout) {
+        while (fread(rec, 1, kHashRecord, f) == kHashRecord) {
+            HashRecord& r = g_hashCache[{ GetLE(rec, 8), GetLE(rec + 8, 8) }];
+            r.size = GetLE(rec + 16, 8);
+            r.mtime = GetLE(rec + 24, 8);
+            memcpy(r.sha256, rec + 32, 32);
+        }
+    }
+    fclose(f);
+}
+
+// Rewrites the cache file through a temporary one, so a reader never sees it
+// half written.
+static void Hash_SaveCache() {
+    if (g_hashCachePath.empty()) return;
+    std::string out;
+    out.reserve(16 + g_hashCache.size() * kHashRecord);
+    PutLE(out, kHashCacheMagic, 4);
+    PutLE(out, kHashCacheLayout, 4);
+    PutLE(out, 0, 8);
+    for (const auto& e : g_hashCache) {
+        PutLE(out, e.first.first, 8);
+        PutLE(out, e.first.second, 8);
+        PutLE(out, e.second.size, 8);
+        PutLE(out, e.second.mtime, 8);
+        out.append(reinterpret_cast<const char*>(e.second.sha256), 32);
+    }
+    const std::wstring tmp = g_hashCachePath + L".tmp";
+    FILE* f = File_Open(tmp, true);
+    if (!f) return;
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    ok = fclose(f) == 0 && ok;
+#ifdef _WIN32
+    if (ok) ok = MoveFileExW(tmp.c_str(), g_hashCachePath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+    if (!ok) DeleteFileW(tmp.c_str());
+#else
+    std::string from, to;
+    AppendUtf8(from, tmp);
+    AppendUtf8(to, g_hashCachePath);
+    if (!ok || rename(from.c_str(), to.c_str()) != 0) unlink(from.c_str());
+#endif
+}
+
+// A page-aligned kHashChunk buffer per hashing thread.
+static uint8_t* Hash_AllocBuffer() {
+#ifdef _WIN32
+    return static_cast<uint8_t*>(VirtualAlloc(nullptr, kHashChunk, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+    void* p = mmap(nullptr, kHashChunk, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? nullptr : static_cast<uint8_t*>(p);
+#endif
+}
+
+static void Hash_FreeBuffer(uint8_t* p) {
+    if (!p) return;
+#ifdef _WIN32
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, kHashChunk);
+#endif
+}
+
+// Hashes the file at path, or takes the hash from the disk cache when the
+// file's ID, size and mtime match. key/rec receive what the cache should hold.
+static bool Hash_File(const std::wstring& path, uint8_t* buf, std::pair<ULONGLONG, ULONGLONG>& key, HashRecord& rec, bool& cached) {
+    Sha256 sha;
+    Sha256_Init(sha);
+#ifdef _WIN32
+    HANDLE h = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    BY_HANDLE_FILE_INFORMATION fi{};
+    if (!GetFileInformationByHandle(h, &fi)) { CloseHandle(h); return false; }
+    key = { fi.dwVolumeSerialNumber, (static_cast<ULONGLONG>(fi.nFileIndexHigh) << 32) | fi.nFileIndexLow };
+    rec.size = (static_cast<ULONGLONG>(fi.nFileSizeHigh) << 32) | fi.nFileSizeLow;
+    rec.mtime = (static_cast<ULONGLONG>(fi.ftLastWriteTime.dwHighDateTime) << 32) | fi.ftLastWriteTime.dwLowDateTime;
+#else
+    std::string p;
+    AppendUtf8(p, path);
+    int fd = open(p.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st {};
+    if (fstat(fd, &st) != 0) { close(fd); return false; }
+    key = { static_cast<ULONGLONG>(st.st_dev), static_cast<ULONGLONG>(st.st_ino) };
+    rec.size = static_cast<ULONGLONG>(st.st_size);
+    rec.mtime = 116444736000000000ULL + static_cast<ULONGLONG>(st.st_mtime) * kTicksPerSecond;
+#ifdef __linux__
+    rec.mtime += static_cast<ULONGLONG>(st.st_mtim.tv_nsec) / 100;
+#endif
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#endif
+    auto hit = g_hashCache.find(key);
+    cached = hit != g_hashCache.end() && hit->second.size == rec.size && hit->second.mtime == rec.mtime;
+    bool ok = true;
+    if (cached) {
+        memcpy(rec.sha256, hit->second.sha256, 32);
+    }
+    else {
+        for (;;) {
+            if (g_hashStop) { ok = false; break; }
+#ifdef _WIN32
+            DWORD n = 0;
+            if (!ReadFile(h, buf, static_cast<DWORD>(kHashChunk), &n, nullptr)) { ok = false; break; }
+#else
+            ssize_t n = read(fd, buf, kHashChunk);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) { ok = false; break; }
+#endif
+            if (n == 0) break;
+            Sha256_Update(sha, buf, static_cast<size_t>(n));
+        }
+        if (ok) Sha256_Final(sha, rec.sha256);
+    }
+#ifdef _WIN32
+    CloseHandle(h);
+#else
+    close(fd);
+#endif
+    return ok;
+}
+
+static std::wstring Hash_Hex(const uint8_t sha256[32]) {
+    static const wchar_t digits[] = L"0123456789abcdef";
+    std::wstring s(64, L'0');
+    for (int i = 0; i < 32; ++i) {
+        s[i * 2] = digits[sha256[i] >> 4];
+        s[i * 2 + 1] = digits[sha256[i] & 15];
+    }
+    return s;
+}
+
+// Fills in the hash of every entry that lacks one, then merges the new ones
+// into the disk cache.
+static void Hash_Run(std::vector<std::pair<const std::wstring*, ExeInfo*>>& todo) {
+    if (todo.empty()) return;
+    if (!g_hashCacheLoaded) Hash_LoadCache();
+    std::stable_sort(todo.begin(), todo.end(), [](const auto& a, const auto& b) {
+        return a.second->stamp.size > b.second->stamp.size;
+        });
+
+    struct Result {
+        std::pair<ULONGLONG, ULONGLONG> key;
+        HashRecord rec;
+        bool ok{ false }, cached{ false };
+    };
+    std::vector<Result> results(todo.size());
+    std::atomic<size_t> nextFile{ 0 };
+    auto worker = [&]() {
+        uint8_t* buf = Hash_AllocBuffer();
+        if (!buf) return;
+        for (size_t i; (i = nextFile++) < todo.size();) {
+            Result& r = results[i];
+            r.ok = Hash_File(*todo[i].first, buf, r.key, r.rec, r.cached);
+        }
+        Hash_FreeBuffer(buf);
+    };
+    unsigned threads = std::min<unsigned>({ static_cast<unsigned>(todo.size()), kHashThreadsMax,
+        std::max(1u, std::thread::hardware_concurrency()) });
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    bool dirty = false;
+    for (size_t i = 0; i < todo.size(); ++i) {
+        const Result& r = results[i];
+        if (!r.ok) continue;
+        ExeInfo& info = *todo[i].second;
+        info.sha256 = Hash_Hex(r.rec.sha256);
+        info.hashed = true;
+        if (!r.cached) {
+            g_hashCache[r.key] = r.rec;
+            dirty = true;
+        }
+    }
+    if (dirty) Hash_SaveCache();
+}
+
+// Written and read by the refreshing thread only.
+static std::unordered_map<std::wstring, ExeInfo> g_exeInfo;
+
+// Cached metadata of path, re-read if the file changed; nullptr if it is gone.
+static ExeInfo* Exe_Lookup(const std::wstring& path) {
+    FileStamp stamp;
+    if (!File_Stamp(path, stamp)) return nullptr;
+    auto it = g_exeInfo.find(path);
+    if (it == g_exeInfo.end() || !(it->second.stamp == stamp)) {
+        ExeInfo info;
+        info.stamp = stamp;
+        Exe_Read(path, info); // a file without them is cached as empty
+        it = g_exeInfo.insert_or_assign(path, std::move(info)).first;
+    }
+    it->second.seen = true;
+    return &it->second;
+}
+
+// The refreshing thread is the UI thread in the window, so Exe_Enrich does
+// not hash: it hands the exes it has no digest for to a background job, shows
+// kHashPending for them meanwhile, and a refresh after the job has finished
+// copies the digests in (g_hashNotify asks for that refresh). One job runs at
+// a time; exes that turn up while it does go into the next one.
+const wchar_t kHashPending[] = L"(hashing)";
+
+struct HashJob {
+    std::thread thread;
+    std::vector<std::pair<std::wstring, ExeInfo>> files; // path, entry as queued; the job fills in the hash
+    std::atomic<bool> done{ false };
+};
+static HashJob g_hashJob;                // started and collected by the refreshing thread
+static void (*g_hashNotify)() = nullptr; // called on the job's thread when it finishes
+
+static void Exe_StartHashing(std::vector<std::pair<std::wstring, ExeInfo>> files) {
+    HashJob& job = g_hashJob;
+    job.files = std::move(files);
+    job.done = false;
+    job.thread = std::thread([&job] {
+        std::vector<std::pair<const std::wstring*, ExeInfo*>> todo;
+        for (auto& f : job.files) todo.emplace_back(&f.first, &f.second);
+        Hash_Run(todo);
+        job.done = true;
+        if (g_hashNotify) g_hashNotify();
+        });
+}
+
+// Copies a finished job's digests into g_exeInfo, waiting for it if wait;
+// true if there was a job. An entry whose file changed since it was queued
+// is left for the next job; one that could not be read stays without a hash.
+static bool Exe_CollectHashes(bool wait) {
+    HashJob& job = g_hashJob;
+    if (!job.thread.joinable() || (!wait && !job.done)) return job.thread.joinable();
+    job.thread.join();
+    job.done = false;
+    for (const auto& f : job.files) {
+        auto it = g_exeInfo.find(f.first);
+        if (it == g_exeInfo.end() || !(it->second.stamp == f.second.stamp)) continue;
+        it->second.sha256 = f.second.sha256;
+        it->second.hashed = true;
+    }
+    job.files.clear();
+    return true;
+}
+
+// At exit: abandons the files the job has not finished reading.
+static void Exe_StopHashing() {
+    g_hashStop = true;
+    if (g_hashJob.thread.joinable()) g_hashJob.thread.join();
+}
+
+// Copies each row's exe metadata into it, queues the Desktop rows' exes not
+// hashed yet, and drops cache entries no row refers to any more.
+static void Exe_Enrich(std::vector<CamRow>& rows) {
+    Exe_CollectHashes(false);
+    std::vector<const ExeInfo*> infos(rows.size());
+    std::vector<std::pair<const ExeInfo*, size_t>> unhashed; // entry, a row naming it
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const ExeInfo* info = rows[i].exe.empty() ? nullptr : Exe_Lookup(rows[i].exe);
+        infos[i] = info;
+        if (info && !info->hashed && rows[i].kind == L"Desktop") unhashed.emplace_back(info, i);
+    }
+    if (!unhashed.empty() && !g_hashJob.thread.joinable()) {
+        // Rows that differ only in capability share an exe.
+        std::sort(unhashed.begin(), unhashed.end());
+        unhashed.erase(std::unique(unhashed.begin(), unhashed.end(),
+            [](const auto& a, const auto& b) { return a.first == b.first; }), unhashed.end());
+        std::vector<std::pair<std::wstring, ExeInfo>> files;
+        files.reserve(unhashed.size());
+        for (const auto& u : unhashed) files.emplace_back(rows[u.second].exe, *u.first);
+        Exe_StartHashing(std::move(files));
+    }
+    for (size_t i = 0; i < rows.size(); ++i) {
+        CamRow& r = rows[i];
+        const ExeInfo* info = infos[i];
+        r.product = info ? info->product : std::wstring();
+        r.company = info ? info->company : std::wstring();
+        r.version = info ? info->version : std::wstring();
+        r.sha256 = !info || r.kind != L"Desktop" ? std::wstring() : info->hashed ? info->sha256 : kHashPending;
+        r.signer = info ? info->signer : std::wstring();
+        r.signerIssuer = info ? info->signerIssuer : std::wstring();
+    }
+    for (auto it = g_exeInfo.begin(); it != g_exeInfo.end();) {
+        if (it->second.seen) (it++)->second.seen = false;
+        else it = g_exeInfo.erase(it);
+    }
+}
+
+// ---------------------- Policy ------------------------------
+// Allow/deny rules over what a row names: the decoded exe path for desktop
+// rows, the package family name for packaged ones. A policy file (--policy)
+// has one rule per line, "allow PATTERN" or "deny PATTERN" ('#' starts a
+// comment), where PATTERN is a glob over the whole subject:
+//   ?   one character other than a separator
+//   *   any run of characters other than a separator
+//   **  any run of characters
+// A pattern ending in a separator is a prefix rule (everything under that
+// directory). \ and / are the same separator, and on Windows matching
+// ignores case. A row is "denied" if a deny rule matches, else "allowed" if
+// an allow rule does, else "unlisted".
+//
+// All rules are compiled into one automaton, so a row costs one pass over its
+// subject whatever the number of rules. The globs become an NFA shaped as a
+// trie of pattern tokens, so rules under a common directory share its states;
+// DFA states, each a set of NFA states, are built lazily the first time a
+// transition is taken and then reused, as in a regex engine's lazy DFA. The
+// cache is dropped when it grows past kPolicyCacheBytes.
+enum PolicyToken : uint8_t { POLICY_LIT, POLICY_ONE, POLICY_STAR, POLICY_ANY };
+
+const uint8_t kPolicyAllow = 1, kPolicyDeny = 2; // verdict bits
+const size_t kPolicyCacheBytes = 32 << 20;
+const int32_t kPolicyUnknown = -1;
+const uint16_t kPolicyClassOther = 0, kPolicyClassSep = 1;
+
+// NFA state: the position after the tokens on its path from the root. A star
+// state is entered without input and then loops on what the star matches.
+struct PolicyNode {
+    uint8_t tok{ POLICY_LIT };  // token leading here
+    uint16_t cls{ 0 };          // character class of a literal
+    uint8_t verdict{ 0 };       // bits of the rules ending here
+    std::vector<uint32_t> next;
+};
+
+struct PolicyDfaState {
+    std::vector<uint32_t> nfa; // sorted NFA states
+    uint8_t verdict{ 0 };
+    std::vector<int32_t> next; // per character class, or kPolicyUnknown
+};
+
+struct Policy {
+    size_t rules{ 0 };
+    std::vector<PolicyNode> nfa{ 1 };   // 0 is the root
+    std::vector<uint16_t> classOf;      // BMP character -> class
+    std::unordered_map<uint32_t, uint16_t> classOfWide; // beyond the BMP
+    uint16_t classes{ 2 };
+    // Lazy DFA; state 0 is dead (no rule can match), 1 is the start.
+    std::vector<PolicyDfaState> dfa;
+    std::unordered_map<std::string, int32_t> dfaByKey;
+    size_t dfaBytes{ 0 };
+    std::vector<uint32_t> mark;         // per NFA state, generation seen
+    uint32_t generation{ 0 };
+};
+
+static Policy g_policy; // loaded at startup, then used by the refreshing thread only
+
+static uint32_t Policy_Fold(wchar_t c) {
+    if (c == L'\\') return L'/';
+#ifdef _WIN32
+    return static_cast<uint32_t>(FoldChar(c));
+#else
+    return static_cast<uint32_t>(c);
+#endif
+}
+
+static uint16_t Policy_ClassOf(const Policy& p, uint32_t c) {
+    if (c == L'/') return kPolicyClassSep;
+    if (c < p.classOf.size()) return p.classOf[c];
+    auto it = p.classOfWide.find(c);
+    return it == p.classOfWide.end() ? kPolicyClassOther : it->second;
+}
+
+static uint16_t Policy_AddClass(Policy& p, uint32_t c) {
+    if (c == L'/') return kPolicyClassSep;
+    uint16_t& k = c < p.classOf.size() ? p.classOf[c] : p.classOfWide[c];
+    if (k == kPolicyClassOther) k = p.classes++;
+    return k;
+}
+
+// Adds one rule's path to the trie.
+static void Policy_AddRule(Policy& p, std::wstring_view pattern, uint8_t verdict) {
+    std::wstring glob(pattern);
+    if (!glob.empty() && (glob.back() == L'\\' || glob.back() == L'/')) glob += L"**";
+    uint32_t at = 0;
+    for (size_t i = 0; i < glob.size(); ++i) {
+        uint8_t t = POLICY_LIT;
+        uint16_t k = 0;
+        if (glob[i] == L'?') t = POLICY_ONE;
+        else if (glob[i] == L'*') {
+            t = POLICY_STAR;
+            while (i + 1 < glob.size() && glob[i + 1] == L'*') { t = POLICY_ANY; ++i; } // *** is **
+        }
+        else k = Policy_AddClass(p, Policy_Fold(glob[i]));
+        uint32_t child = 0;
+        for (uint32_t c : p.nfa[at].next) {
+            if (p.nfa[c].tok == t && p.nfa[c].cls == k) { child = c; break; }
+        }
+        if (child == 0) {
+            child = static_cast<uint32_t>(p.nfa.size());
+            p.nfa.emplace_back();
+            p.nfa.back().tok = t;
+            p.nfa.back().cls = k;
+            p.nfa[at].next.push_back(child);
+        }
+        at = child;
+    }
+    p.nfa[at].verdict |= verdict;
+    ++p.rules;
+}
+
+// Adds s and the star states it enters without input (a star may match
+// nothing).
+static void Policy_Close(Policy& p, uint32_t s, std::vector<uint32_t>& set) {
+    if (p.mark[s] == p.generation) return;
+    p.mark[s] = p.generation;
+    set.push_back(s);
+    for (uint32_t c : p.nfa[s].next) {
+        if (p.nfa[c].tok == POLICY_STAR || p.nfa[c].tok == POLICY_ANY) Policy_Close(p, c, set);
+    }
+}
+
+static int32_t Policy_Intern(Policy& p, std::vector<uint32_t>& set) {
+    if (set.empty()) return 0;
+    std::sort(set.begin(), set.end());
+    std::string key(reinterpret_cast<const char*>(set.data()), set.size() * sizeof(uint32_t));
+    auto it = p.dfaByKey.find(key);
+    if (it != p.dfaByKey.end()) return it->second;
+    PolicyDfaState st;
+    for (uint32_t s : set) st.verdict |= p.nfa[s].verdict;
+    st.next.assign(p.classes, kPolicyUnknown);
+    p.dfaBytes += 2 * key.size() + st.next.size() * sizeof(int32_t);
+    st.nfa = std::move(set);
+    const int32_t id = static_cast<int32_t>(p.dfa.size());
+    p.dfa.push_back(std::move(st));
+    p.dfaByKey.emplace(std::move(key), id);
+    return id;
+}
+
+// (Re)creates the dead and start states, dropping every other DFA state.
+static void Policy_ResetDfa(Policy& p) {
+    p.dfa.clear();
+    p.dfaByKey.clear();
+    p.dfaBytes = 0;
+    p.dfa.emplace_back();
+    p.dfa[0].next.assign(p.classes, 0); // dead stays dead
+    std::vector<uint32_t> start;
+    ++p.generation;
+    Policy_Close(p, 0, start);
+    Policy_Intern(p, start); // state 1
+}
+
+static int32_t Policy_Step(Policy& p, int32_t from, uint16_t k) {
+    std::vector<uint32_t> set;
+    ++p.generation;
+    const bool sep = k == kPolicyClassSep;
+    for (uint32_t s : p.dfa[from].nfa) {
+        const PolicyNode& n = p.nfa[s];
+        if (n.tok == POLICY_ANY || (n.tok == POLICY_STAR && !sep)) Policy_Close(p, s, set);
+        for (uint32_t c : n.next) {
+            const PolicyNode& m = p.nfa[c];
+            if ((m.tok == POLICY_LIT && m.cls == k) || (m.tok == POLICY_ONE && !sep)) Policy_Close(p, c, set);
+        }
+    }
+    int32_t to = Policy_Intern(p, set);
+    p.dfa[from].next[k] = to; // after Intern: it may have grown dfa
+    return to;
+}
+
+// Parses a policy file. Returns false if it cannot be read; lines that are
+// not rules are counted in bad.
+static bool Policy_Load(Policy& p, const std::wstring& path, size_t& bad) {
+    bad = 0;
+    FILE* f = File_Open(path, false);
+    if (!f) return false;
+    p = Policy();
+    p.classOf.assign(0x10000, kPolicyClassOther);
+    std::string text;
+    char buf[65536];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;) text.append(buf, n);
+    fclose(f);
+    if (text.compare(0, 3, "\xEF\xBB\xBF") == 0) text.erase(0, 3);
+
+    std::wstring line;
+    for (size_t at = 0; at < text.size();) {
+        size_t eol = text.find('\n', at);
+        if (eol == std::string::npos) eol = text.size();
+        line.clear();
+        AppendWide(line, std::string_view(text).substr(at, eol - at));
+        at = eol + 1;
+        while (!line.empty() && (line.back() == L'\r' || line.back() == L' ' || line.back() == L'\t')) line.pop_back();
+        size_t from = line.find_first_not_of(L" \t");
+        if (from == std::wstring::npos || line[from] == L'#') continue;
+        size_t space = line.find_first_of(L" \t", from);
+        size_t arg = space == std::wstring::npos ? space : line.find_first_not_of(L" \t", space);
+        std::wstring_view verb = std::wstring_view(line).substr(from, space - from);
+        if (arg == std::wstring::npos || (verb != L"allow" && verb != L"deny")) { ++bad; continue; }
+        Policy_AddRule(p, std::wstring_view(line).substr(arg), verb == L"deny" ? kPolicyDeny : kPolicyAllow);
+    }
+    p.mark.assign(p.nfa.size(), 0);
+    if (p.rules) Policy_ResetDfa(p);
+    return true;
+}
+
+// Verdict bits of the rules matching subject, in one pass over it.
+static uint8_t Policy_Match(Policy& p, std::wstring_view subject) {
+    if (p.dfaBytes > kPolicyCacheBytes) Policy_ResetDfa(p);
+    int32_t st = 1;
+    for (size_t i = 0; i < subject.size() && st != 0; ++i) {
+        const uint16_t k = Policy_ClassOf(p, Policy_Fold(subject[i]));
+        int32_t to = p.dfa[st].next[k];
+        st = to != kPolicyUnknown ? to : Policy_Step(p, st, k);
+    }
+    return p.dfa[st].verdict;
+}
+
+static void Policy_Apply(Policy& p, std::vector<CamRow>& rows) {
+    if (p.rules == 0) return;
+    for (CamRow& r : rows) {
+        const uint8_t v = Policy_Match(p, r.exe.empty() ? std::wstring_view(r.app) : std::wstring_view(r.exe));
+        r.policy = (v & kPolicyDeny) ? L"denied" : (v & kPolicyAllow) ? L"allowed" : L"unlisted";
+    }
+}
+
+// ---------------------- Refresh -----------------------------
+// One scan + publish cycle, shared by the window, the watch mode and the
+// headless build.
+static Timeline g_timeline; // written and read by the refreshing thread only
+static AvOverlap g_avOverlap; // likewise
+
+static void RefreshSnapshot() {
+    auto t0 = std::chrono::steady_clock::now();
+    ULONGLONG calls = 0;
+#ifdef _WIN32
+    if (g_allUsers) LoadAllUsers(g_rows);
+    else LoadConsentStore(g_rows);
+    calls = g_regCalls;
+#elif defined(__linux__)
+    Proc_Load(g_rows, DevWatch_TakePending());
+#else
+    g_rows.clear(); // no usage source on this platform yet
+#endif
+    Exe_Enrich(g_rows);
+    Policy_Apply(g_policy, g_rows);
+    std::chrono::duration<double> scan = std::chrono::steady_clock::now() - t0;
+    size_t changed = PublishSnapshot(g_rows);
+    Shm_Publish(*CurrentSnapshot());
+    const ULONGLONG now = NowFt();
+    Timeline_Record(g_timeline, *CurrentSnapshot(), now);
+    Correlate_CameraMicrophone(g_avOverlap, *CurrentSnapshot(), g_timeline, now);
+    ULONGLONG liveApps = 0, overlap = 0;
+    for (const AppInterval& o : g_avOverlap.live) liveApps += o.end == now;
+    for (const AppInterval& o : g_avOverlap.history) overlap += o.end - o.start;
+    Metrics_RecordOverlap(liveApps, overlap / kTicksPerSecond);
+    Metrics_RecordRefresh(scan.count(), calls, changed);
+}
+
+// ---------------------- Search Index ------------------------
+// Trigram index over the case-folded App and EXE text, kept in step with the
+// published snapshots. Rows get a stable id when they first appear; posting
+// lists hold ascending ids, so new rows are appended and a query intersects
+// the lists of its trigrams, then confirms each candidate against the stored
+// text. Ids of removed rows stay in the lists until there are more dead ids
+// than live ones, at which point the index is rebuilt.
+struct TextIndex {
+    ULONGLONG version{ 0 };          // snapshot currently indexed
+    std::vector<uint32_t> idOfRow;   // snapshot row -> id
+    std::vector<uint32_t> rowOfId;   // id -> snapshot row, kNoRow once removed
+    std::vector<uint32_t> textStart; // id -> offset into text (one extra at the end)
+    std::wstring text;               // folded "app\nexe" per id, back to back
+    std::unordered_map<ULONGLONG, std::vector<uint32_t>> postings;
+    size_t dead{ 0 };
+};
+
+static ULONGLONG Trigram(const wchar_t* p) {
+    auto c = [](wchar_t ch) { return std::min<ULONGLONG>(static_cast<ULONGLONG>(ch), 0x1FFFFF); };
+    return (c(p[0]) << 42) | (c(p[1]) << 21) | c(p[2]);
+}
+
+static void FoldInto(std::wstring& out, const std::wstring& s) {
+    for (wchar_t ch : s) out += FoldChar(ch);
+}
+
+static uint32_t TextIndex_Add(TextIndex& ix, const CamRow& r, std::vector<ULONGLONG>& grams) {
+    const uint32_t id = static_cast<uint32_t>(ix.rowOfId.size());
+    const size_t start = ix.text.size();
+    FoldInto(ix.text, r.app);
+    ix.text += L'\n';
+    FoldInto(ix.text, r.exe);
+    ix.textStart.back() = static_cast<uint32_t>(start);
+    ix.textStart.push_back(static_cast<uint32_t>(ix.text.size()));
+    ix.rowOfId.push_back(kNoRow);
+
+    grams.clear();
+    for (size_t i = start; i + 3 <= ix.text.size(); ++i) {
+        const wchar_t* p = ix.text.data() + i;
+        if (p[0] == L'\n' || p[1] == L'\n' || p[2] == L'\n') continue;
+        grams.push_back(Trigram(p));
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    for (ULONGLONG g : grams) ix.postings[g].push_back(id);
+    return id;
+}
+
+static void TextIndex_Rebuild(TextIndex& ix, const Snapshot& snap) {
+    ix = TextIndex();
+    ix.textStart.push_back(0);
+    ix.idOfRow.resize(snap.rows.size());
+    std::vector<ULONGLONG> grams;
+    for (size_t j = 0; j < snap.rows.size(); ++j) {
+        uint32_t id = TextIndex_Add(ix, snap.rows[j], grams);
+        ix.idOfRow[j] = id;
+        ix.rowOfId[id] = static_cast<uint32_t>(j);
+    }
+    ix.version = snap.version;
+}
+
+// Brings the index to snap using its diff; only rows new in snap are indexed.
+static void TextIndex_Apply(TextIndex& ix, const Snapshot& snap) {
+    if (!ix.textStart.empty() && snap.version == ix.version) return;
+    const size_t live = ix.rowOfId.size() - ix.dead;
+    if (ix.textStart.empty() || snap.version != ix.version + 1 || ix.dead > live) {
+        TextIndex_Rebuild(ix, snap);
+        return;
+    }
+
+    for (uint32_t old : snap.removed) {
+        ix.rowOfId[ix.idOfRow[old]] = kNoRow;
+        ++ix.dead;
+    }
+    std::vector<uint32_t> idOfRow(snap.rows.size());
+    std::vector<ULONGLONG> grams;
+    for (size_t j = 0; j < snap.rows.size(); ++j) {
+        uint32_t from = snap.fromPrev[j];
+        uint32_t id = from != kNoRow ? ix.idOfRow[from] : TextIndex_Add(ix, snap.rows[j], grams);
+        idOfRow[j] = id;
+        ix.rowOfId[id] = static_cast<uint32_t>(j);
+    }
+    ix.idOfRow.swap(idOfRow);
+    ix.version = snap.version;
+}
+
+static bool TextIndex_Contains(const TextIndex& ix, uint32_t id, const std::wstring& folded) {
+    std::wstring_view t(ix.text.data() + ix.textStart[id], ix.textStart[id + 1] - ix.textStart[id]);
+    return t.find(folded) != std::wstring_view::npos;
+}
+
+// Sets match[row] for every row of the indexed snapshot whose App or EXE
+// contains query (case-insensitive). Queries shorter than a trigram scan the
+// folded text, which is one contiguous buffer.
+static void TextIndex_Query(const TextIndex& ix, const std::wstring& query, std::vector<uint8_t>& match) {
+    match.assign(ix.idOfRow.size(), 0);
+    std::wstring q;
+    FoldInto(q, query);
+
+    if (q.size() < 3) {
+        for (uint32_t id = 0; id < ix.rowOfId.size(); ++id) {
+            if (ix.rowOfId[id] != kNoRow && TextIndex_Contains(ix, id, q)) match[ix.rowOfId[id]] = 1;
+        }
+        return;
+    }
+
+    std::vector<const std::vector<uint32_t>*> lists;
+    for (size_t i = 0; i + 3 <= q.size(); ++i) {
+        auto it = ix.postings.find(Trigram(q.data() + i));
+        if (it == ix.postings.end()) return;
+        lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(), [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) {
+        return a->size() < b->size();
+        });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+    // Intersect from the shortest list: binary search into much longer lists,
+    // a plain merge when the sizes are close.
+    std::vector<uint32_t> cand(lists[0]->begin(), lists[0]->end());
+    for (size_t l = 1; l < lists.size() && !cand.empty(); ++l) {
+        const std::vector<uint32_t>& other = *lists[l];
+        size_t out = 0;
+        auto pos = other.begin();
+        const bool search = other.size() / 16 > cand.size();
+        for (uint32_t id : cand) {
+            if (search) pos = std::lower_bound(pos, other.end(), id);
+            else while (pos != other.end() && *pos < id) ++pos;
+            if (pos == other.end()) break;
+            if (*pos == id) cand[out++] = id;
+        }
+        cand.resize(out);
+    }
+
+    // A single trigram is its own answer; longer queries confirm the order.
+    const bool exact = q.size() == 3;
+    for (uint32_t id : cand) {
+        uint32_t row = ix.rowOfId[id];
+        if (row != kNoRow && (exact || TextIndex_Contains(ix, id, q))) match[row] = 1;
+    }
+}
+
+// ---------------------- Row Groups --------------------------
+// Folds rows into groups by product, publisher, directory or container, with
+// per-group aggregates kept up to date from the snapshot diffs: a refresh only
+// subtracts removed and changed rows and adds new and changed ones. Most
+// recent use is a maximum, so when the row holding it leaves, the group is
+// marked stale and fixed with one pass at the end of the update.
+enum GroupBy { GROUP_NONE, GROUP_PRODUCT, GROUP_PUBLISHER, GROUP_DIRECTORY, GROUP_CONTAINER };
+
+struct RowGroup {
+    std::wstring key;           // folded label
+    std::wstring label;
+    size_t count{ 0 };
+    size_t active{ 0 };
+    ULONGLONG closedTicks{ 0 }; // sum of stop - start over finished rows
+    ULONGLONG activeStarts{ 0 };// sum of startFt over running rows
+    ULONGLONG latest{ 0 };      // newest startFt
+    bool stale{ false };
+    bool expanded{ false };
+};
+
+struct GroupView {
+    GroupBy by{ GROUP_NONE };
+    GroupBy builtBy{ GROUP_NONE };
+    std::shared_ptr<const Snapshot> snap;
+    std::vector<uint32_t> groupOfRow; // snapshot row -> groups index
+    std::unordered_map<std::wstring, uint32_t> byKey;
+    std::vector<RowGroup> groups;     // a group whose rows all left stays with count 0
+};
+
+// First path component after one of the usual install roots, e.g.
+// "Google" for C:\Program Files\Google\Chrome\Application\chrome.exe.
+static std::wstring PublisherFromPath(const std::wstring& exe) {
+    static const wchar_t* const roots[] = {
+        L"\\program files\\", L"\\program files (x86)\\", L"\\programdata\\",
+        L"\\appdata\\local\\programs\\", L"\\appdata\\local\\", L"\\appdata\\roaming\\",
+    };
+    std::wstring folded;
+    FoldInto(folded, exe);
+    for (const wchar_t* root : roots) {
+        size_t at = folded.find(root);
+        if (at == std::wstring::npos) continue;
+        size_t from = at + wcslen(root);
+        size_t end = exe.find(L'\\', from);
+        if (end != std::wstring::npos && end > from) return exe.substr(from, end - from);
+    }
+    if (folded.find(L"\\windows\\") != std::wstring::npos) return L"Windows";
+    return L"";
+}
+
+static std::wstring Group_Label(GroupBy by, const CamRow& r) {
+    const bool packaged = r.exe.empty();
+    std::wstring label;
+    switch (by) {
+    case GROUP_PRODUCT:
+        // The catalog name, so one app's exes and packages fold together;
+        // else the family name without the publisher id, or the EXE name.
+        if (!r.name.empty()) label = r.name;
+        else label = packaged ? r.app.substr(0, r.app.find(L'_')) : r.app;
+        break;
+    case GROUP_PUBLISHER:
+        if (packaged) {
+            size_t us = r.app.rfind(L'_');
+            if (us != std::wstring::npos) label = r.app.substr(us + 1);
+        }
+        else {
+            label = PublisherFromPath(r.exe);
+        }
+        break;
+    case GROUP_DIRECTORY:
+        if (packaged) {
+            label = L"Packaged apps";
+        }
+        else {
+            size_t slash = r.exe.find_last_of(L"\\/");
+            if (slash != std::wstring::npos) label = r.exe.substr(0, slash);
+        }
+        break;
+    case GROUP_CONTAINER:
+        label = r.container.empty() ? L"(host)" : r.container;
+        break;
+    default:
+        break;
+    }
+    return label.empty() ? L"(unknown)" : label;
+}
+
+static void Group_Add(RowGroup& g, const CamRow& r) {
+    ++g.count;
+    if (r.startFt == 0) return;
+    if (r.activeNow) {
+        ++g.active;
+        g.activeStarts += r.startFt;
+    }
+    else if (r.stopFt >= r.startFt) {
+        g.closedTicks += r.stopFt - r.startFt;
+    }
+    if (r.startFt > g.latest) g.latest = r.startFt;
+}
+
+static void Group_Remove(GroupView& gv, uint32_t id, const CamRow& r, std::vector<uint32_t>& stale) {
+    RowGroup& g = gv.groups[id];
+    --g.count;
+    if (r.startFt == 0) return;
+    if (r.activeNow) {
+        --g.active;
+        g.activeStarts -= r.startFt;
+    }
+    else if (r.stopFt >= r.startFt) {
+        g.closedTicks -= r.stopFt - r.startFt;
+    }
+    if (r.startFt == g.latest && !g.stale) {
+        g.stale = true;
+        stale.push_back(id);
+    }
+}
+
+static uint32_t Group_Find(GroupView& gv, const CamRow& r) {
+    std::wstring label = Group_Label(gv.by, r);
+    std::wstring key;
+    FoldInto(key, label);
+    auto ins = gv.byKey.emplace(key, static_cast<uint32_t>(gv.groups.size()));
+    if (ins.second) {
+        gv.groups.emplace_back();
+        gv.groups.back().key = std::move(key);
+        gv.groups.back().label = std::move(label);
+    }
+    return ins.first->second;
+}
+
+// Brings the groups to snap. A different grouping or a skipped snapshot
+// rebuilds them, keeping which groups were expanded.
+static void Group_Apply(GroupView& gv, const std::shared_ptr<const Snapshot>& snap) {
+    if (gv.snap == snap && gv.builtBy == gv.by) return;
+    const Snapshot& s = *snap;
+    std::vector<uint32_t> stale;
+    std::vector<uint32_t> groupOfRow(s.rows.size());
+
+    if (!gv.snap || gv.builtBy != gv.by || s.version != gv.snap->version + 1) {
+        std::vector<std::wstring> expanded;
+        if (gv.builtBy == gv.by) {
+            for (const RowGroup& g : gv.groups) if (g.expanded) expanded.push_back(g.key);
+        }
+        gv.groups.clear();
+        gv.byKey.clear();
+        for (size_t j = 0; j < s.rows.size(); ++j) {
+            groupOfRow[j] = Group_Find(gv, s.rows[j]);
+            Group_Add(gv.groups[groupOfRow[j]], s.rows[j]);
+        }
+        for (const std::wstring& key : expanded) {
+            auto it = gv.byKey.find(key);
+            if (it != gv.byKey.end()) gv.groups[it->second].expanded = true;
+        }
+    }
+    else {
+        const Snapshot& old = *gv.snap;
+        for (uint32_t r : s.removed) Group_Remove(gv, gv.groupOfRow[r], old.rows[r], stale);
+        for (size_t j = 0; j < s.rows.size(); ++j) {
+            uint32_t from = s.fromPrev[j];
+            if (from == kNoRow) {
+                groupOfRow[j] = Group_Find(gv, s.rows[j]);
+                Group_Add(gv.groups[groupOfRow[j]], s.rows[j]);
+                continue;
+            }
+            // Matched rows have the same kind/app/exe, hence the same group.
+            groupOfRow[j] = gv.groupOfRow[from];
+            if (s.rows[j].changedIn != s.version) continue;
+            Group_Remove(gv, groupOfRow[j], old.rows[from], stale);
+            Group_Add(gv.groups[groupOfRow[j]], s.rows[j]);
+        }
+    }
+
+    if (!stale.empty()) {
+        for (uint32_t id : stale) gv.groups[id].latest = 0;
+        for (size_t j = 0; j < s.rows.size(); ++j) {
+            RowGroup& g = gv.groups[groupOfRow[j]];
+            if (g.stale) g.latest = std::max(g.latest, s.rows[j].startFt);
+        }
+        for (uint32_t id : stale) gv.groups[id].stale = false;
+    }
+    gv.groupOfRow.swap(groupOfRow);
+    gv.snap = snap;
+    gv.builtBy = gv.by;
+}
+
+// Finished session time plus the running sessions up to now.
+static ULONGLONG Group_TotalTicks(const RowGroup& g, ULONGLONG now) {
+    ULONGLONG running = g.active * now;
+    return g.closedTicks + (running > g.activeStarts ? running - g.activeStarts : 0);
+}
+
+static std::wstring FormatDuration(ULONGLONG ticks) {
+    ULONGLONG sec = ticks / kTicksPerSecond;
+    wchar_t buf[64];
+    if (sec >= 3600) swprintf(buf, std::size(buf), L"%lluh %02llum", sec / 3600, sec % 3600 / 60);
+    else if (sec >= 60) swprintf(buf, std::size(buf), L"%llum %02llus", sec / 60, sec % 60);
+    else swprintf(buf, std::size(buf), L"%llus", sec);
+    return buf;
+}
+
+// ---------------------- Row View Model ----------------------
+// Backs the owner-data ListView: maps list items to snapshot rows and keeps
+// formatted cells for a window of items around what the list is showing.
+// Text columns are served straight from the snapshot row; the Time columns
+// (Last Start, Last Stop) are formatted once per item while it stays inside
+// the window. With grouping on, each group is a parent item followed by its
+// rows when expanded, and its summary cells are kept in the window too.
+struct RowCells {
+    std::wstring text[kColumnCount]; // Time columns for rows, every column but App for groups
+};
+
+const uint32_t kGroupItem = 0x80000000u; // items entry naming a group, not a row
+
+struct RowView {
+    std::shared_ptr<const Snapshot> snap;
+    bool currentOnly{ false };
+    std::wstring query;           // App/EXE search text, "" => no text filter
+    std::vector<uint8_t> match;   // per snapshot row, from TextIndex_Query
+    const GroupView* groups{ nullptr }; // grouping, in step with snap
+    bool grouped{ false };        // items were built with groups
+    int sortCol{ -1 };            // -1 => snapshot order (active first, newest start)
+    bool sortDesc{ false };
+    std::vector<uint32_t> items;  // list item -> index into snap->rows, or kGroupItem | group
+    size_t first{ 0 };            // list item held in window[0]
+    std::vector<RowCells> window;
+    std::vector<RowCells> spare;  // recycled when the window moves
+    std::wstring scratch;
+};
+
+const size_t kRowViewPage = 64; // window size used when a cell misses without a hint
+
+// Ascending order of rows a and b by column col. Ties on the packed key fall
+// back to the full strings, so the order depends only on row contents (never
+// on row indices) and survives from one snapshot to the next.
+static bool RowView_Less(const Snapshot& s, int col, uint32_t a, uint32_t b) {
+    const std::vector<ULONGLONG>* key = s.sortKey;
+    if (key[col][a] != key[col][b]) return key[col][a] < key[col][b];
+    const CamRow& ra = s.rows[a];
+    const CamRow& rb = s.rows[b];
+    int c = kColumnInfo[col].compare(ra, rb);
+    // Then by the identity columns: folded, then exact.
+    ForEachColumn([&](auto t) {
+        if (c == 0 && key[t][a] != key[t][b]) c = key[t][a] < key[t][b] ? -1 : 1;
+        if (c == 0) c = Column_Compare<t>(ra, rb);
+    }, IdentityColumns());
+    ForEachColumn([&](auto t) {
+        if (c == 0) c = (ra.*ColumnAt<t>::field).compare(rb.*ColumnAt<t>::field);
+    }, IdentityColumns());
+    return c < 0;
+}
+
+// Sorts items by the view's sort column. Data that is already in order, or
+// exactly reversed, is handled in one linear pass; otherwise the packed keys
+// are sorted next to the row indices so most comparisons stay in one array.
+static void RowView_Order(RowView& v, std::vector<uint32_t>& items) {
+    if (v.sortCol < 0) return;
+    const Snapshot& s = *v.snap;
+    const int col = v.sortCol;
+    const bool desc = v.sortDesc;
+    auto less = [&](uint32_t a, uint32_t b) {
+        return desc ? RowView_Less(s, col, b, a) : RowView_Less(s, col, a, b);
+    };
+    if (std::is_sorted(items.begin(), items.end(), less)) return;
+    if (std::is_sorted(items.rbegin(), items.rend(), less)) {
+        std::reverse(items.begin(), items.end());
+        return;
+    }
+
+    std::vector<std::pair<ULONGLONG, uint32_t>> keyed;
+    keyed.reserve(items.size());
+    for (uint32_t i : items) keyed.push_back({ s.sortKey[col][i], i });
+    std::sort(keyed.begin(), keyed.end(), [&](const std::pair<ULONGLONG, uint32_t>& a, const std::pair<ULONGLONG, uint32_t>& b) {
+        if (a.first != b.first) return desc ? a.first > b.first : a.first < b.first;
+        return less(a.second, b.second);
+        });
+    for (size_t i = 0; i < items.size(); ++i) items[i] = keyed[i].second;
+}
+
+static bool RowView_Visible(const RowView& v, size_t row) {
+    if (v.currentOnly && !v.snap->rows[row].activeNow) return false;
+    return v.query.empty() || v.match[row];
+}
+
+static bool RowView_Grouped(const RowView& v) {
+    return v.groups && v.groups->by != GROUP_NONE;
+}
+
+// Group order for the sort column: count, active count or most recent use
+// for Kind, Active and Last Start, otherwise the label. Unsorted lists put
+// groups with running sessions first, then the most recently used.
+static bool RowView_GroupLess(const RowView& v, uint32_t a, uint32_t b) {
+    const RowGroup& ga = v.groups->groups[a];
+    const RowGroup& gb = v.groups->groups[b];
+    if (v.sortCol < 0) {
+        if ((ga.active != 0) != (gb.active != 0)) return ga.active != 0;
+        if (ga.latest != gb.latest) return ga.latest > gb.latest;
+    }
+    else {
+        if (v.sortDesc) std::swap(a, b);
+        const RowGroup& x = v.groups->groups[a];
+        const RowGroup& y = v.groups->groups[b];
+        switch (v.sortCol) {
+        case COL_KIND: if (x.count != y.count) return x.count < y.count; break;
+        case COL_ACTIVE: if (x.active != y.active) return x.active < y.active; break;
+        case COL_START: if (x.latest != y.latest) return x.latest < y.latest; break;
+        }
+        int c = CompareFolded(x.key, y.key, 0);
+        if (c != 0) return c < 0;
+        return x.label < y.label;
+    }
+    return ga.key < gb.key;
+}
+
+// Parent items for groups with visible rows, each followed by its visible
+// rows in the view's order when expanded.
+static void RowView_BuildGroups(RowView& v) {
+    const GroupView& gv = *v.groups;
+    std::vector<std::vector<uint32_t>> members(gv.groups.size());
+    for (size_t i = 0; i < v.snap->rows.size(); ++i) {
+        if (RowView_Visible(v, i)) members[gv.groupOfRow[i]].push_back(static_cast<uint32_t>(i));
+    }
+    std::vector<uint32_t> order;
+    for (uint32_t g = 0; g < members.size(); ++g) {
+        if (!members[g].empty()) order.push_back(g);
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return RowView_GroupLess(v, a, b); });
+    for (uint32_t g : order) {
+        v.items.push_back(kGroupItem | g);
+        if (!gv.groups[g].expanded) continue;
+        RowView_Order(v, members[g]);
+        v.items.insert(v.items.end(), members[g].begin(), members[g].end());
+    }
+}
+
+static void RowView_Reset(RowView& v, std::shared_ptr<const Snapshot> snap, bool currentOnly) {
+    v.snap = std::move(snap);
+    v.currentOnly = currentOnly;
+    v.items.clear();
+    v.items.reserve(v.snap->rows.size());
+    v.grouped = RowView_Grouped(v);
+    if (v.grouped) {
+        RowView_BuildGroups(v);
+    }
+    else {
+        for (size_t i = 0; i < v.snap->rows.size(); ++i) {
+            if (RowView_Visible(v, i)) v.items.push_back(static_cast<uint32_t>(i));
+        }
+        RowView_Order(v, v.items);
+    }
+    v.first = 0;
+    v.window.clear();
+}
+
+// Changes the sort column/direction; tracked item positions are remapped like
+// in RowView_Apply.
+static void RowView_SetSort(RowView& v, int col, bool desc, std::vector<size_t>& tracked) {
+    std::vector<uint32_t> rows(tracked.size(), kNoRow);
+    for (size_t t = 0; t < tracked.size(); ++t) {
+        if (tracked[t] < v.items.size()) rows[t] = v.items[tracked[t]];
+    }
+
+    if (RowView_Grouped(v)) {
+        v.sortCol = col;
+        v.sortDesc = desc;
+        RowView_Reset(v, v.snap, v.currentOnly);
+    }
+    else if (col == v.sortCol) {
+        // Already sorted by this column (a total order), so a direction
+        // change is an exact reversal and needs no comparisons.
+        if (desc != v.sortDesc) std::reverse(v.items.begin(), v.items.end());
+        v.sortDesc = desc;
+    }
+    else {
+        v.sortCol = col;
+        v.sortDesc = desc;
+        RowView_Order(v, v.items);
+    }
+    v.first = 0;
+    v.window.clear();
+
+    if (tracked.empty()) return;
+    // Group items are numbered after the rows.
+    const size_t nrows = v.snap->rows.size();
+    auto slot = [&](uint32_t item) { return (item & kGroupItem) ? nrows + (item & ~kGroupItem) : item; };
+    std::vector<size_t> pos(nrows + (v.groups ? v.groups->groups.size() : 0), SIZE_MAX);
+    for (size_t j = 0; j < v.items.size(); ++j) pos[slot(v.items[j])] = j;
+    for (size_t t = 0; t < tracked.size(); ++t) tracked[t] = rows[t] != kNoRow ? pos[slot(rows[t])] : SIZE_MAX;
+}
+
+// Moves the view to snap, which must be the snapshot published right after
+// v.snap (returns false otherwise and the caller resets instead); match is
+// the search result for snap. dirty
+// receives the inclusive item ranges whose text differs from before, merged
+// and ascending, within the length both lists share. tracked holds item
+// positions (selection, focus) that are remapped in place to where the same
+// rows are now, or SIZE_MAX if gone. With a sort column, unchanged rows keep
+// their relative order, so only new and changed rows are sorted and merged in.
+static bool RowView_Apply(RowView& v, std::shared_ptr<const Snapshot> snap, std::vector<uint8_t>& match,
+    std::vector<size_t>& tracked, std::vector<std::pair<size_t, size_t>>& dirty) {
+    dirty.clear();
+    if (!v.snap || snap->version != v.snap->version + 1 || v.grouped || RowView_Grouped(v)) return false;
+    v.match.swap(match);
+
+    // New and changed rows come from snap->changed, so nothing below reads
+    // the rows themselves (a cache miss each) except to filter Current only.
+    std::vector<uint8_t> stale(snap->rows.size(), 0);
+    for (uint32_t j : snap->changed) stale[j] = 1;
+
+    std::vector<uint32_t> oldItems;
+    oldItems.swap(v.items);
+    std::vector<uint32_t> oldRows(tracked.size(), kNoRow);
+    for (size_t t = 0; t < tracked.size(); ++t) {
+        if (tracked[t] < oldItems.size()) oldRows[t] = oldItems[tracked[t]];
+    }
+
+    const size_t prevRows = v.snap->rows.size();
+    if (v.sortCol < 0) {
+        RowView_Reset(v, std::move(snap), v.currentOnly);
+    }
+    else {
+        v.snap = std::move(snap);
+        v.first = 0;
+        v.window.clear();
+        const Snapshot& s = *v.snap;
+
+        std::vector<uint32_t> toNext(prevRows, kNoRow);
+        for (size_t j = 0; j < s.rows.size(); ++j) {
+            if (!stale[j]) toNext[s.fromPrev[j]] = static_cast<uint32_t>(j);
+        }
+        std::vector<uint32_t> kept, fresh;
+        kept.reserve(oldItems.size());
+        for (uint32_t old : oldItems) {
+            uint32_t j = toNext[old];
+            if (j != kNoRow && RowView_Visible(v, j)) kept.push_back(j);
+        }
+        for (uint32_t j : s.changed) {
+            if (RowView_Visible(v, j)) fresh.push_back(j);
+        }
+        RowView_Order(v, fresh);
+        v.items.resize(kept.size() + fresh.size());
+        std::merge(kept.begin(), kept.end(), fresh.begin(), fresh.end(), v.items.begin(), [&](uint32_t a, uint32_t b) {
+            return v.sortDesc ? RowView_Less(s, v.sortCol, b, a) : RowView_Less(s, v.sortCol, a, b);
+            });
+    }
+    const Snapshot& s = *v.snap;
+
+    size_t common = std::min(oldItems.size(), v.items.size());
+    for (size_t j = 0; j < common; ++j) {
+        uint32_t row = v.items[j];
+        if (s.fromPrev[row] == oldItems[j] && !stale[row]) continue;
+        if (!dirty.empty() && dirty.back().second + 1 == j) dirty.back().second = j;
+        else dirty.push_back({ j, j });
+    }
+
+    if (!tracked.empty()) {
+        std::vector<size_t> posOfPrev(prevRows, SIZE_MAX);
+        for (size_t j = 0; j < v.items.size(); ++j) {
+            uint32_t from = s.fromPrev[v.items[j]];
+            if (from != kNoRow) posOfPrev[from] = j;
+        }
+        for (size_t t = 0; t < tracked.size(); ++t) {
+            tracked[t] = oldRows[t] != kNoRow ? posOfPrev[oldRows[t]] : SIZE_MAX;
+        }
+    }
+    return true;
+}
+
+static size_t RowView_Count(const RowView& v) {
+    return v.items.size();
+}
+
+// Makes [from, to] formatted, plus one window length of neighbors on each
+// side so scrolling by a page does not miss. Items already in the window are
+// moved, not reformatted.
+static void RowView_Prefetch(RowView& v, size_t from, size_t to) {
+    if (v.items.empty()) return;
+    to = std::min(to, v.items.size() - 1);
+    if (from > to) return;
+    if (from >= v.first && to < v.first + v.window.size()) return;
+
+    size_t span = to - from + 1;
+    size_t nf = from > span ? from - span : 0;
+    size_t nl = std::min(v.items.size(), to + 1 + span);
+
+    v.spare.resize(nl - nf);
+    for (size_t i = nf; i < nl; ++i) {
+        RowCells& dst = v.spare[i - nf];
+        if (i >= v.first && i < v.first + v.window.size()) {
+            dst = std::move(v.window[i - v.first]);
+        }
+        else if (v.items[i] & kGroupItem) {
+            const RowGroup& g = v.groups->groups[v.items[i] & ~kGroupItem];
+            for (std::wstring& t : dst.text) t.clear();
+            dst.text[COL_KIND] = (g.expanded ? L"[-] " : L"[+] ") + std::to_wstring(g.count);
+            dst.text[COL_EXE] = L"Total " + FormatDuration(Group_TotalTicks(g, NowFt()));
+            dst.text[COL_ACTIVE] = g.active ? L"Yes (" + std::to_wstring(g.active) + L")" : L"No";
+            dst.text[COL_START] = FtToLocalString(g.latest);
+        }
+        else {
+            const CamRow& r = v.snap->rows[v.items[i]];
+            ForEachColumn([&](auto c) {
+                if constexpr (ColumnAt<c>::type == ColType::Time) Column_Text<c>(r, dst.text[c]);
+            });
+        }
+    }
+    v.window.swap(v.spare);
+    v.first = nf;
+}
+
+static const wchar_t* RowView_Cell(RowView& v, size_t item, int col) {
+    if (item >= v.items.size()) return L"";
+    if (col < 0 || static_cast<size_t>(col) >= kColumnCount) return L"";
+    const bool group = (v.items[item] & kGroupItem) != 0;
+    if (!group) {
+        // Only times are formatted; the rest is served from the row as is.
+        if (kColumnInfo[col].type != ColType::Time) return kColumnInfo[col].text(v.snap->rows[v.items[item]], v.scratch);
+    }
+    else if (col == COL_APP) {
+        return v.groups->groups[v.items[item] & ~kGroupItem].label.c_str();
+    }
+    if (item < v.first || item >= v.first + v.window.size()) {
+        RowView_Prefetch(v, item > kRowViewPage / 2 ? item - kRowViewPage / 2 : 0, item + kRowViewPage / 2);
+    }
+    return v.window[item - v.first].text[col].c_str();
+}
+
+#ifdef _WIN32
+// Expands or collapses the group at item; false if item is a row. (ListView
+// only: the terminal views show groups as summary lines.)
+static bool RowView_ToggleGroup(RowView& v, GroupView& gv, size_t item) {
+    if (item >= v.items.size() || !(v.items[item] & kGroupItem)) return false;
+    RowGroup& g = gv.groups[v.items[item] & ~kGroupItem];
+    g.expanded = !g.expanded;
+    RowView_Reset(v, v.snap, v.currentOnly);
+    return true;
+}
+#endif
+
+// ---------------------- Command-Line View -------------------
+// --watch and --export go through the same view model as the window:
+// --current, --search TEXT and --sort COLUMN[:desc] pick and order the rows,
+// and --group BY (watch only) shows one summary line per group. --timeline
+// SPAN (watch only) shows the recorded camera use instead of the rows.
+struct ViewOptions {
+    bool currentOnly{ false };
+    std::wstring query;
+    int sortCol{ -1 };
+    bool sortDesc{ false };
+    GroupBy group{ GROUP_NONE };
+    ULONGLONG timeline{ 0 }; // --timeline (watch only): span of the camera strips shown instead of the rows
+};
+
+struct ViewState {
+    TextIndex index;
+    GroupView groups;
+    RowView view;
+};
+
+// COLUMN is a CSV/JSON column name, any case; ":desc" reverses the order.
+static bool View_ParseSort(ViewOptions& o, std::wstring_view arg) {
+    bool desc = false;
+    const size_t colon = arg.find(L':');
+    if (colon != std::wstring_view::npos) {
+        std::wstring_view dir = arg.substr(colon + 1);
+        if (dir != L"desc" && dir != L"asc") return false;
+        desc = dir == L"desc";
+        arg = arg.substr(0, colon);
+    }
+    for (size_t c = 0; c < kColumnCount; ++c) {
+        const char* name = kColumnInfo[c].name;
+        size_t i = 0;
+        while (i < arg.size() && name[i] && FoldChar(arg[i]) == FoldChar(static_cast<wchar_t>(name[i]))) ++i;
+        if (i == arg.size() && !name[i]) {
+            o.sortCol = static_cast<int>(c);
+            o.sortDesc = desc;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool View_ParseGroup(ViewOptions& o, std::wstring_view arg) {
+    static const std::pair<const wchar_t*, GroupBy> names[] = {
+        { L"none", GROUP_NONE }, { L"product", GROUP_PRODUCT }, { L"publisher", GROUP_PUBLISHER },
+        { L"directory", GROUP_DIRECTORY }, { L"container", GROUP_CONTAINER },
+    };
+    for (const auto& n : names) {
+        if (arg == n.first) {
+            o.group = n.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool View_ParseTimeline(ViewOptions& o, std::wstring_view arg) {
+    static const std::pair<const wchar_t*, ULONGLONG> spans[] = {
+        { L"day", 24 * 3600 * kTicksPerSecond }, { L"week", 7 * 24 * 3600 * kTicksPerSecond },
+        { L"month", 30 * 24 * 3600 * kTicksPerSecond },
+    };
+    for (const auto& sp : spans) {
+        if (arg == sp.first) {
+            o.timeline = sp.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Brings the view to snap: the index and groups follow the snapshot diffs,
+// and the rows are only re-sorted when new or changed.
+static void View_Update(ViewState& vs, const ViewOptions& o, std::shared_ptr<const Snapshot> snap) {
+    TextIndex_Apply(vs.index, *snap);
+    vs.groups.by = o.group;
+    if (o.group != GROUP_NONE) Group_Apply(vs.groups, snap);
+    vs.view.groups = &vs.groups;
+    std::vector<uint8_t> match;
+    if (!o.query.empty()) TextIndex_Query(vs.index, o.query, match);
+
+    std::vector<size_t> tracked;
+    std::vector<std::pair<size_t, size_t>> dirty;
+    if (o.currentOnly != vs.view.currentOnly || o.query != vs.view.query ||
+        !RowView_Apply(vs.view, snap, match, tracked, dirty)) {
+        vs.view.query = o.query;
+        vs.view.match = std::move(match);
+        RowView_Reset(vs.view, std::move(snap), o.currentOnly);
+    }
+    if (o.sortCol != vs.view.sortCol || o.sortDesc != vs.view.sortDesc) {
+        RowView_SetSort(vs.view, o.sortCol, o.sortDesc, tracked);
+    }
+}
+
+// ---------------------- Terminal Watch Mode -----------------
+// Renders the ListView's columns, rows and groups to a VT terminal. The previous
+// frame's cells are kept; each frame only rewrites cells whose text changed,
+// moves the cursor only when the next changed cell is not adjacent, and is
+// emitted with a single write. Frames are only built when a new snapshot is
+// published or the terminal is resized, so an idle watch just sleeps.
+static std::atomic<bool> g_watchStop{ false };
+
+struct WatchScreen {
+    int width{ 0 }, height{ 0 };
+    int colX[kColumnCount]{}, colW[kColumnCount]{};
+    std::vector<std::string> cells; // last frame, (height - 2) lines x kColumnCount
+    std::string frame;              // reused output buffer
+    std::string cell;
+    std::wstring text;
+    int curY{ -1 }, curX{ -1 };     // cursor position after the last write
+};
+
+static void Watch_TerminalSize(int& w, int& h) {
+    w = 120; h = 40;
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO csbi{};
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi)) {
+        w = csbi.srWindow.Right - csbi.srWindow.Left + 1;
+        h = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
+    }
+#else
+    winsize ws{};
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+        w = ws.ws_col;
+        h = ws.ws_row;
+    }
+#endif
+}
+
+static void Watch_Write(const std::string& s) {
+#ifdef _WIN32
+    DWORD put = 0;
+    WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), s.data(), static_cast<DWORD>(s.size()), &put, nullptr);
+#else
+    size_t off = 0;
+    while (off < s.size()) {
+        ssize_t n = write(STDOUT_FILENO, s.data() + off, s.size() - off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        off += static_cast<size_t>(n);
+    }
+#endif
+}
+
+// Terminal cells taken by code point c: 0 for combining marks and other
+// zero-width characters, 2 for East Asian wide and fullwidth ones and emoji.
+static int Watch_CharWidth(uint32_t c) {
+    if ((c >= 0x0300 && c <= 0x036F) || (c >= 0x200B && c <= 0x200F) || (c >= 0xFE00 && c <= 0xFE0F) ||
+        (c >= 0x20D0 && c <= 0x20FF) || c == 0xFEFF) return 0;
+    if ((c >= 0x1100 && c <= 0x115F) || (c >= 0x2E80 && c <= 0xA4CF && c != 0x303F) ||
+        (c >= 0xAC00 && c <= 0xD7A3) || (c >= 0xF900 && c <= 0xFAFF) || (c >= 0xFE30 && c <= 0xFE4F) ||
+        (c >= 0xFF00 && c <= 0xFF60) || (c >= 0xFFE0 && c <= 0xFFE6) || (c >= 0x1F300 && c <= 0x1F64F) ||
+        (c >= 0x1F900 && c <= 0x1F9FF) || (c >= 0x20000 && c <= 0x3FFFD)) return 2;
+    return 1;
+}
+
+// Writes s into out clipped/padded to exactly width terminal cells. A wide
+// character that would straddle the edge is left out, and a surrogate pair
+// is never split.
+static void Watch_Fit(std::string& out, std::wstring_view s, int width) {
+    out.clear();
+    int used = 0;
+    size_t end = 0;
+    while (end < s.size()) {
+        uint32_t c = static_cast<uint32_t>(s[end]);
+        size_t n = 1;
+        if (c >= 0xD800 && c <= 0xDBFF && end + 1 < s.size() && s[end + 1] >= 0xDC00 && s[end + 1] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (static_cast<uint32_t>(s[end + 1]) - 0xDC00);
+            n = 2;
+        }
+        const int cw = Watch_CharWidth(c);
+        if (used + cw > width) break;
+        used += cw;
+        end += n;
+    }
+    AppendUtf8(out, s.substr(0, end));
+    out.append(static_cast<size_t>(width - used), ' ');
+}
+
+const int kWatchFlexMin = 10; // fewest cells the flexible column gets
+
+static void Watch_Layout(WatchScreen& scr, int w, int h) {
+    scr.width = w;
+    scr.height = h;
+    // Fixed columns are dropped (width 0), lowest watchKeep first and the
+    // rightmost of equals, until the flexible one gets at least kWatchFlexMin
+    // cells: file metadata goes before state and times. On a terminal too
+    // narrow even for what is left, columns are cut at the right edge.
+    bool shown[kColumnCount];
+    size_t order[kColumnCount];
+    int used = -1; // no separator before the first column
+    for (size_t c = 0; c < kColumnCount; ++c) {
+        shown[c] = true;
+        order[c] = c;
+        used += (kColumnInfo[c].watchWidth ? kColumnInfo[c].watchWidth : kWatchFlexMin) + 1;
+    }
+    std::sort(order, order + kColumnCount, [](size_t a, size_t b) {
+        return kColumnInfo[a].watchKeep != kColumnInfo[b].watchKeep ? kColumnInfo[a].watchKeep < kColumnInfo[b].watchKeep : a > b;
+        });
+    for (size_t i = 0; i < kColumnCount && used > w; ++i) {
+        const size_t c = order[i];
+        if (!kColumnInfo[c].watchWidth) continue;
+        shown[c] = false;
+        used -= kColumnInfo[c].watchWidth + 1;
+    }
+    int x = 1;
+    for (size_t c = 0; c < kColumnCount; ++c) {
+        const int want = kColumnInfo[c].watchWidth;
+        const int cw = !shown[c] ? 0 : want ? want : kWatchFlexMin + std::max(0, w - used);
+        scr.colW[c] = std::max(0, std::min(cw, w - x + 1));
+        scr.colX[c] = x;
+        if (scr.colW[c]) x += scr.colW[c] + 1;
+    }
+    // The screen is cleared on layout, so start from blank cells.
+    scr.cells.resize(static_cast<size_t>(std::max(0, h - 2)) * kColumnCount);
+    for (size_t i = 0; i < scr.cells.size(); ++i) scr.cells[i].assign(static_cast<size_t>(scr.colW[i % kColumnCount]), ' ');
+    scr.curY = scr.curX = -1;
+}
+
+static void Watch_MoveTo(WatchScreen& scr, int y, int x) {
+    if (scr.curY == y && scr.curX == x) return;
+    if (scr.curY == y && scr.curX + 1 == x) {
+        scr.frame += ' '; // column separator is already a blank
+    }
+    else {
+        char buf[24];
+        int n = snprintf(buf, sizeof(buf), "\x1b[%d;%dH", y, x);
+        scr.frame.append(buf, static_cast<size_t>(n));
+    }
+    scr.curY = y;
+    scr.curX = x;
+}
+
+static void Watch_PutCell(WatchScreen& scr, std::string& prev, int y, int c) {
+    if (prev == scr.cell) return;
+    Watch_MoveTo(scr, y, scr.colX[c]);
+    scr.frame += scr.cell;
+    scr.curX += scr.colW[c];
+    prev = scr.cell;
+}
+
+static void Watch_Render(WatchScreen& scr, RowView& v, bool full) {
+    const Snapshot& snap = *v.snap;
+    scr.frame.clear();
+    if (full) {
+        scr.frame += "\x1b[H\x1b[2J";
+        scr.curY = scr.curX = -1;
+        scr.frame += "\x1b[1m";
+        for (size_t c = 0; c < kColumnCount; ++c) {
+            if (!scr.colW[c]) continue;
+            Watch_Fit(scr.cell, kColumnInfo[c].title, scr.colW[c]);
+            Watch_MoveTo(scr, 1, scr.colX[c]);
+            scr.frame += scr.cell;
+            scr.curX += scr.colW[c];
+        }
+        scr.frame += "\x1b[0m";
+    }
+
+    const size_t bodyLines = static_cast<size_t>(std::max(0, scr.height - 2));
+    const size_t shown = std::min(bodyLines, RowView_Count(v));
+    size_t active = 0;
+    for (const auto& r : snap.rows) active += r.activeNow;
+    if (shown) RowView_Prefetch(v, 0, shown - 1);
+    for (size_t line = 0; line < bodyLines; ++line) {
+        std::string* prev = &scr.cells[line * kColumnCount];
+        const int y = static_cast<int>(line) + 2;
+        for (size_t c = 0; c < kColumnCount; ++c) {
+            Watch_Fit(scr.cell, line < shown ? RowView_Cell(v, line, static_cast<int>(c)) : L"", scr.colW[c]);
+            Watch_PutCell(scr, prev[c], y, static_cast<int>(c));
+        }
+    }
+
+    char status[128];
+    int n = snprintf(status, sizeof(status), "%zu rows, %zu active, showing %zu - snapshot %llu - Ctrl+C to quit",
+        snap.rows.size(), active, shown, snap.version);
+    Watch_MoveTo(scr, scr.height, 1);
+    scr.frame += "\x1b[7m";
+    scr.frame.append(status, static_cast<size_t>(std::min(n, scr.width)));
+    scr.frame += "\x1b[0m\x1b[K";
+    scr.curX = -1;
+
+    Watch_Write(scr.frame);
+}
+
+// --timeline: one line per app that had the camera on within span before
+// now, its name and then a strip whose cells fill up with the share of their
+// time the camera was on. Lines that did not change are not rewritten.
+static void Watch_RenderTimeline(WatchScreen& scr, const Timeline& tl, ULONGLONG span, ULONGLONG now, bool full) {
+    static const char* const kShade[] = { " ", u8"\u2581", u8"\u2582", u8"\u2583", u8"\u2584",
+        u8"\u2585", u8"\u2586", u8"\u2587", u8"\u2588" };
+    const ULONGLONG from = now > span ? now - span : 0;
+    const int labelW = std::min(24, scr.width / 3);
+    const int stripW = std::max(0, scr.width - labelW - 1);
+    scr.frame.clear();
+
+    std::vector<const AppTimeline*> apps;
+    for (const AppTimeline& a : tl.apps) {
+        if (a.id.capability == kCapCamera && !a.sessions.empty() && a.sessions.back().second > from) apps.push_back(&a);
+    }
+    std::sort(apps.begin(), apps.end(), [](const AppTimeline* x, const AppTimeline* y) {
+        return x->sessions.back().second > y->sessions.back().second;
+        });
+
+    const unsigned long long cellMin = stripW ? span / stripW / (60 * kTicksPerSecond) : 0;
+    if (full) {
+        scr.frame += "\x1b[H\x1b[2J\x1b[1m";
+        scr.curY = scr.curX = -1;
+        Watch_Fit(scr.cell, L"App", labelW);
+        scr.frame += scr.cell;
+        char head[96];
+        int n = snprintf(head, sizeof(head), " Camera on, %llu min per cell", cellMin);
+        scr.frame.append(head, static_cast<size_t>(std::max(0, std::min(n, stripW + 1))));
+        scr.frame += "\x1b[0m";
+    }
+
+    const size_t bodyLines = static_cast<size_t>(std::max(0, scr.height - 2));
+    const size_t shown = std::min(bodyLines, apps.size());
+    std::vector<float> cover;
+    for (size_t line = 0; line < bodyLines; ++line) {
+        scr.cell.clear();
+        if (line < shown) {
+            Watch_Fit(scr.cell, apps[line]->id.app, labelW);
+            scr.cell += ' ';
+            Timeline_Render(*apps[line], from, now, static_cast<unsigned>(stripW), cover);
+            for (float f : cover) scr.cell += kShade[std::min(8, static_cast<int>(f * 8 + 0.5f))];
+        }
+        std::string& prev = scr.cells[line * kColumnCount];
+        if (prev == scr.cell) continue;
+        Watch_MoveTo(scr, static_cast<int>(line) + 2, 1);
+        scr.frame += scr.cell;
+        scr.frame += "\x1b[K";
+        scr.curX = -1;
+        prev = scr.cell;
+    }
+
+    char status[128];
+    const unsigned long long hours = span / (3600 * kTicksPerSecond);
+    int n = hours < 48 ? snprintf(status, sizeof(status), "%zu apps, camera over the last %llu h - Ctrl+C to quit", apps.size(), hours)
+        : snprintf(status, sizeof(status), "%zu apps, camera over the last %llu days - Ctrl+C to quit", apps.size(), hours / 24);
+    Watch_MoveTo(scr, scr.height, 1);
+    scr.frame += "\x1b[7m";
+    scr.frame.append(status, static_cast<size_t>(std::min(n, scr.width)));
+    scr.frame += "\x1b[0m\x1b[K";
+    scr.curX = -1;
+
+    Watch_Write(scr.frame);
+}
+
+// Sleeps up to ms; true if a watched device changed meanwhile (Linux).
+static bool Watch_Wait(unsigned ms) {
+#ifdef _WIN32
+    Sleep(ms);
+#else
+#ifdef __linux__
+    if (g_devWatch.fd >= 0) return DevWatch_Wait(ms);
+#endif
+    poll(nullptr, 0, static_cast<int>(ms)); // returns early on SIGWINCH / SIGINT
+#endif
+    return false;
+}
+
+#ifdef _WIN32
+static BOOL WINAPI Watch_CtrlHandler(DWORD) {
+    g_watchStop = true;
+    return TRUE;
+}
+#else
+static void Watch_OnSignal(int sig) {
+    if (sig != SIGWINCH) g_watchStop = true;
+}
+#endif
+
+static int Watch_Run(unsigned intervalMs, const ViewOptions& options) {
+#ifdef _WIN32
+    HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (GetConsoleMode(hOut, &mode)) SetConsoleMode(hOut, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    SetConsoleOutputCP(CP_UTF8);
+    SetConsoleCtrlHandler(Watch_CtrlHandler, TRUE);
+    const unsigned kTickMs = 100; // no resize notification; poll the window size
+#else
+    struct sigaction sa {};
+    sa.sa_handler = Watch_OnSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGWINCH, &sa, nullptr);
+    const unsigned kTickMs = 1000;
+#endif
+    Watch_Write("\x1b[?1049h\x1b[?25l");
+
+    WatchScreen scr;
+    ViewState vs;
+    ULONGLONG shownVersion = 0;
+    auto nextScan = std::chrono::steady_clock::now();
+    while (!g_watchStop) {
+        auto now = std::chrono::steady_clock::now();
+        bool scanned = false;
+        if (now >= nextScan) {
+            RefreshSnapshot();
+            scanned = true;
+            nextScan = now + std::chrono::milliseconds(intervalMs);
+        }
+
+        int w = 0, h = 0;
+        Watch_TerminalSize(w, h);
+        bool resized = w != scr.width || h != scr.height;
+        if (resized) Watch_Layout(scr, w, h);
+
+        std::shared_ptr<const Snapshot> snap = CurrentSnapshot();
+        // The strips slide with the clock, so they are redrawn after every scan.
+        if (resized || snap->version != shownVersion || (options.timeline && scanned)) {
+            shownVersion = snap->version;
+            if (options.timeline) {
+                Watch_RenderTimeline(scr, g_timeline, options.timeline, NowFt(), resized);
+            }
+            else {
+                View_Update(vs, options, std::move(snap));
+                Watch_Render(scr, vs.view, resized);
+            }
+        }
+
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(nextScan - std::chrono::steady_clock::now()).count();
+        // A device event, or digests to publish, calls for a scan now.
+        if (Watch_Wait(static_cast<unsigned>(std::max<long long>(1, std::min<long long>(left, kTickMs)))) || g_hashJob.done) {
+            nextScan = std::chrono::steady_clock::now();
+        }
+    }
+
+    Watch_Write("\x1b[0m\x1b[?25h\x1b[?1049l");
+    Exe_StopHashing();
+    return 0;
+}
+
+// ---------------------- Export ------------------------------
+// CSV and JSON renderings of a snapshot, one line or object per row, with
+// the columns and their names taken from kColumns.
+static void Export_CsvField(std::string& out, const wchar_t* text) {
+    std::string utf8;
+    AppendUtf8(utf8, text);
+    if (utf8.find_first_of(",\"\r\n") == std::string::npos) {
+        out += utf8;
+        return;
+    }
+    out += '"';
+    for (char ch : utf8) {
+        if (ch == '"') out += '"';
+        out += ch;
+    }
+    out += '"';
+}
+
+static void Export_JsonString(std::string& out, const std::wstring& s) {
+    std::string utf8;
+    AppendUtf8(utf8, s);
+    out += '"';
+    for (char ch : utf8) {
+        unsigned char u = static_cast<unsigned char>(ch);
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        }
+        else if (u < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", u);
+            out += esc;
+        }
+        else {
+            out += ch;
+        }
+    }
+    out += '"';
+}
+
+// JSON value: strings, booleans, and times as local "YYYY-MM-DD hh:mm:ss"
+// (null when unset).
+template <size_t C>
+static void Column_Json(std::string& out, const CamRow& r) {
+    using Col = ColumnAt<C>;
+    if constexpr (Col::type == ColType::Text) {
+        Export_JsonString(out, r.*Col::field);
+    }
+    else if constexpr (Col::type == ColType::Flag) {
+        out += r.*Col::field ? "true" : "false";
+    }
+    else {
+        std::wstring t = FtToLocalString(r.*Col::field);
+        if (t.empty()) out += "null";
+        else Export_JsonString(out, t);
+    }
+}
+
+static void Export_Csv(const Snapshot& snap, const std::vector<uint32_t>& rows, std::string& out) {
+    ForEachColumn([&](auto c) {
+        if (c) out += ',';
+        out += std::get<c>(kColumns).name;
+    });
+    out += "\r\n";
+    std::wstring scratch;
+    for (uint32_t i : rows) {
+        const CamRow& r = snap.rows[i];
+        ForEachColumn([&](auto c) {
+            if (c) out += ',';
+            Export_CsvField(out, Column_Text<c>(r, scratch));
+        });
+        out += "\r\n";
+    }
+}
+
+static void Export_Json(const Snapshot& snap, const std::vector<uint32_t>& rows, std::string& out) {
+    out += "[";
+    for (size_t i = 0; i < rows.size(); ++i) {
+        out += i ? ",\n  {" : "\n  {";
+        ForEachColumn([&](auto c) {
+            if (c) out += ", ";
+            out += '"';
+            out += std::get<c>(kColumns).name;
+            out += "\": ";
+            Column_Json<c>(out, snap.rows[rows[i]]);
+        });
+        out += '}';
+    }
+    out += rows.empty() ? "]\n" : "\n]\n";
+}
+
+// Scans once and writes the rows the options select, in their order, to
+// stdout. Grouping does not apply: the output is always rows.
+static int Export_Run(bool json, ViewOptions options) {
+    std::string out;
+    // One scan is all there is, so it waits for the digests: each refresh
+    // after a job publishes them (and may queue exes found meanwhile).
+    RefreshSnapshot();
+    while (Exe_CollectHashes(true)) RefreshSnapshot();
+    ViewState vs;
+    options.group = GROUP_NONE;
+    View_Update(vs, options, CurrentSnapshot());
+    if (json) Export_Json(*vs.view.snap, vs.view.items, out);
+    else Export_Csv(*vs.view.snap, vs.view.items, out);
+    Watch_Write(out);
+    return 0;
+}
+
+#ifdef _WIN32
+// ---------------------- UI ---------------------------------
+static RowView g_view;
+static TextIndex g_index;
+static GroupView g_groups;
+
+static void ListView_SetupColumns(HWND hList) {
+    ListView_DeleteAllItems(hList);
+    while (ListView_DeleteColumn(hList, 0)) {}
+
+    LVCOLUMNW col{};
+    col.mask = LVCF_TEXT | LVCF_WIDTH | LVCF_SUBITEM;
+    for (size_t c = 0; c < kColumnCount; ++c) {
+        col.pszText = const_cast<wchar_t*>(kColumnInfo[c].title);
+        col.cx = kColumnInfo[c].listWidth;
+        col.iSubItem = static_cast<int>(c);
+        ListView_InsertColumn(hList, static_cast<int>(c), &col);
+    }
+}
+
+// The list is owner-data (LVS_OWNERDATA): it only holds an item count and
+// asks for text through LVN_GETDISPINFO, answered from g_view.
+static void ListView_Populate(HWND hList, std::shared_ptr<const Snapshot> snap, bool currentOnly,
+    const std::wstring& query, std::vector<uint8_t> match) {
+    g_view.query = query;
+    g_view.match = std::move(match);
+    RowView_Reset(g_view, std::move(snap), currentOnly);
+    ListView_SetItemCountEx(hList, static_cast<int>(RowView_Count(g_view)), LVSICF_NOSCROLL);
+    InvalidateRect(hList, nullptr, FALSE);
+}
+
+// Selected item positions followed by the focused one (SIZE_MAX if none).
+static void ListView_SaveSelection(HWND hList, std::vector<size_t>& tracked) {
+    tracked.clear();
+    for (int i = ListView_GetNextItem(hList, -1, LVNI_SELECTED); i != -1; i = ListView_GetNextItem(hList, i, LVNI_SELECTED)) {
+        tracked.push_back(static_cast<size_t>(i));
+    }
+    int focus = ListView_GetNextItem(hList, -1, LVNI_FOCUSED);
+    tracked.push_back(focus >= 0 ? static_cast<size_t>(focus) : SIZE_MAX);
+}
+
+static void ListView_RestoreSelection(HWND hList, const std::vector<size_t>& tracked) {
+    ListView_SetItemState(hList, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+    for (size_t t = 0; t + 1 < tracked.size(); ++t) {
+        if (tracked[t] != SIZE_MAX) ListView_SetItemState(hList, static_cast<int>(tracked[t]), LVIS_SELECTED, LVIS_SELECTED);
+    }
+    if (!tracked.empty() && tracked.back() != SIZE_MAX) {
+        ListView_SetItemState(hList, static_cast<int>(tracked.back()), LVIS_FOCUSED, LVIS_FOCUSED);
+    }
+}
+
+// Applies only what changed since the previous snapshot: the item count,
+// repaints of the changed item ranges, and the selection/focus moved to
+// follow their rows. Falls back to ListView_Populate when the filter or the
+// search text changed, and while grouped. Brings g_index and g_groups up to
+// snap first.
+static void ListView_Update(HWND hList, std::shared_ptr<const Snapshot> snap, bool currentOnly, const std::wstring& query) {
+    TextIndex_Apply(g_index, *snap);
+    if (g_groups.by != GROUP_NONE) Group_Apply(g_groups, snap);
+    g_view.groups = &g_groups;
+    std::vector<uint8_t> match;
+    if (!query.empty()) TextIndex_Query(g_index, query, match);
+
+    std::vector<size_t> tracked;
+    ListView_SaveSelection(hList, tracked);
+    std::vector<size_t> before = tracked;
+
+    size_t oldCount = RowView_Count(g_view);
+    std::vector<std::pair<size_t, size_t>> dirty;
+    if (currentOnly != g_view.currentOnly || query != g_view.query ||
+        !RowView_Apply(g_view, snap, match, tracked, dirty)) {
+        ListView_Populate(hList, std::move(snap), currentOnly, query, std::move(match));
+        return;
+    }
+    size_t newCount = RowView_Count(g_view);
+    if (dirty.empty() && oldCount == newCount && tracked == before) return;
+
+    SendMessageW(hList, WM_SETREDRAW, FALSE, 0);
+    if (oldCount != newCount) {
+        ListView_SetItemCountEx(hList, static_cast<int>(newCount), LVSICF_NOINVALIDATEALL | LVSICF_NOSCROLL);
+    }
+    if (tracked != before) ListView_RestoreSelection(hList, tracked);
+    SendMessageW(hList, WM_SETREDRAW, TRUE, 0);
+
+    // Invalidate after redraw is back on; the list ignores it while suspended.
+    // Items past the old count are repainted by the count change itself.
+    for (const auto& d : dirty) ListView_RedrawItems(hList, static_cast<int>(d.first), static_cast<int>(d.second));
+}
+
+// Header click: sort by that column, toggling direction on a repeat click.
+static void ListView_SortBy(HWND hList, int col) {
+    bool desc = (g_view.sortCol == col) ? !g_view.sortDesc : false;
+    std::vector<size_t> tracked;
+    ListView_SaveSelection(hList, tracked);
+    RowView_SetSort(g_view, col, desc, tracked);
+
+    SendMessageW(hList, WM_SETREDRAW, FALSE, 0);
+    ListView_RestoreSelection(hList, tracked);
+    HWND hHeader = ListView_GetHeader(hList);
+    for (int c = 0; c < Header_GetItemCount(hHeader); ++c) {
+        HDITEMW hd{};
+        hd.mask = HDI_FORMAT;
+        Header_GetItem(hHeader, c, &hd);
+        hd.fmt &= ~(HDF_SORTUP | HDF_SORTDOWN);
+        if (c == col) hd.fmt |= desc ? HDF_SORTDOWN : HDF_SORTUP;
+        Header_SetItem(hHeader, c, &hd);
+    }
+    SendMessageW(hList, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(hList, nullptr, FALSE);
+}
+
+static LRESULT ListView_OnNotify(NMHDR* hdr) {
+    switch (hdr->code) {
+    case LVN_GETDISPINFOW: {
+        LVITEMW& item = reinterpret_cast<NMLVDISPINFOW*>(hdr)->item;
+        if ((item.mask & LVIF_TEXT) && item.pszText && item.cchTextMax > 0) {
+            const wchar_t* text = RowView_Cell(g_view, static_cast<size_t>(item.iItem), item.iSubItem);
+            lstrcpynW(item.pszText, text, item.cchTextMax);
+        }
+        return 0;
+    }
+    case LVN_COLUMNCLICK:
+        ListView_SortBy(hdr->hwndFrom, reinterpret_cast<NMLISTVIEW*>(hdr)->iSubItem);
+        return 0;
+    case LVN_ITEMACTIVATE: {
+        // Enter or double-click on a group expands/collapses it.
+        const NMITEMACTIVATE* act = reinterpret_cast<NMITEMACTIVATE*>(hdr);
+        if (act->iItem >= 0 && RowView_ToggleGroup(g_view, g_groups, static_cast<size_t>(act->iItem))) {
+            ListView_SetItemCountEx(hdr->hwndFrom, static_cast<int>(RowView_Count(g_view)), LVSICF_NOSCROLL);
+            InvalidateRect(hdr->hwndFrom, nullptr, FALSE);
+        }
+        return 0;
+    }
+    case LVN_ODCACHEHINT: {
+        const NMLVCACHEHINT* hint = reinterpret_cast<NMLVCACHEHINT*>(hdr);
+        RowView_Prefetch(g_view, static_cast<size_t>(hint->iFrom), static_cast<size_t>(hint->iTo));
+        return 0;
+    }
+    }
+    return 0;
+}
+
+static std::wstring SearchText() {
+    std::wstring text(static_cast<size_t>(GetWindowTextLengthW(g_hSearch)) + 1, L'\0');
+    text.resize(static_cast<size_t>(GetWindowTextW(g_hSearch, &text[0], static_cast<int>(text.size()))));
+    return text;
+}
+
+// Re-filters the list without rescanning (search box edits).
+static void ApplyFilter() {
+    BOOL curOnly = (Button_GetCheck(g_hChkCurrent) == BST_CHECKED);
+    ListView_Update(g_hList, CurrentSnapshot(), curOnly != FALSE, SearchText());
+}
+
+static void DoRefresh(HWND hWnd) {
+    RefreshSnapshot();
+    BOOL curOnly = (Button_GetCheck(g_hChkCurrent) == BST_CHECKED);
+    ListView_Update(g_hList, CurrentSnapshot(), curOnly != FALSE, SearchText());
+    int parts[1] = { -1 };
+    SendMessageW(g_hStatus, SB_SETPARTS, 1, (LPARAM)parts);
+    SendMessageW(g_hStatus, SB_SETTEXT, 0, (LPARAM)L"Ready - Bob Paydar");
+}
+
+static void ResizeLayout(HWND hWnd) {
+    RECT rc{}; GetClientRect(hWnd, &rc);
+
+    SendMessageW(g_hStatus, WM_SIZE, 0, 0);
+    RECT rcStatus{}; GetWindowRect(g_hStatus, &rcStatus);
+    int sbHeight = rcStatus.bottom - rcStatus.top;
+
+    int padding = 8;
+    int btnW = 100, btnH = 28;
+    int chkW = 140, chkH = 24;
+    int searchW = 260, searchH = 24;
+    int groupW = 170, groupH = 200; // combo height includes the drop-down
+
+    int topBarH = btnH + padding * 2;
+
+    MoveWindow(g_hBtnRefresh, padding, padding, btnW, btnH, TRUE);
+    MoveWindow(g_hChkCurrent, padding + btnW + 10, padding + 2, chkW, chkH, TRUE);
+    MoveWindow(g_hSearch, padding + btnW + 10 + chkW + 10, padding + 2, searchW, searchH, TRUE);
+    MoveWindow(g_hGroup, padding + btnW + 10 + chkW + 10 + searchW + 10, padding + 2, groupW, groupH, TRUE);
+
+    int listY = topBarH;
+    int listH = rc.bottom - listY - sbHeight;
+    MoveWindow(g_hList, 0, listY, rc.right - rc.left, listH, TRUE);
+}
+
+static void InitListView(HWND hList) {
+    DWORD ex = ListView_GetExtendedListViewStyle(hList);
+    ex |= LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES;
+    ListView_SetExtendedListViewStyle(hList, ex);
+    ListView_SetupColumns(hList);
+}
+
+// ---------------------- Win32 Boilerplate -------------------
+static LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    switch (msg) {
+    case WM_CREATE:
+        g_hBtnRefresh = CreateWindowExW(0, L"BUTTON", L"Refresh",
+            WS_CHILD | WS_VISIBLE | WS_TABSTOP,
+            0, 0, 0, 0, hWnd, (HMENU)IDC_REFRESH, g_hInst, nullptr);
+
+        g_hChkCurrent = CreateWindowExW(0, L"BUTTON", L"Current only",
+            WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX | WS_TABSTOP,
+            0, 0, 0, 0, hWnd, (HMENU)IDC_CURONLY, g_hInst, nullptr);
+
+        g_hSearch = CreateWindowExW(WS_EX_CLIENTEDGE, L"EDIT", L"",
+            WS_CHILD | WS_VISIBLE | WS_TABSTOP | ES_AUTOHSCROLL,
+            0, 0, 0, 0, hWnd, (HMENU)IDC_SEARCH, g_hInst, nullptr);
+        SendMessageW(g_hSearch, WM_SETFONT, (WPARAM)GetStockObject(DEFAULT_GUI_FONT), TRUE);
+
+        g_hGroup = CreateWindowExW(0, L"COMBOBOX", L"",
+            WS_CHILD | WS_VISIBLE | WS_TABSTOP | CBS_DROPDOWNLIST,
+            0, 0, 0, 0, hWnd, (HMENU)IDC_GROUP, g_hInst, nullptr);
+        SendMessageW(g_hGroup, WM_SETFONT, (WPARAM)GetStockObject(DEFAULT_GUI_FONT), TRUE);
+        ComboBox_AddString(g_hGroup, L"No grouping");
+        ComboBox_AddString(g_hGroup, L"Group by product");
+        ComboBox_AddString(g_hGroup, L"Group by publisher");
+        ComboBox_AddString(g_hGroup, L"Group by directory");
+        ComboBox_AddString(g_hGroup, L"Group by container");
+        ComboBox_SetCurSel(g_hGroup, GROUP_NONE);
+
+        g_hList = CreateWindowExW(WS_EX_CLIENTEDGE, WC_LISTVIEWW, L"",
+            WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_SHOWSELALWAYS | LVS_OWNERDATA,
+            0, 0, 0, 0, hWnd, (HMENU)IDC_LIST, g_hInst, nullptr);
+
+        g_hStatus = CreateWindowExW(0, STATUSCLASSNAMEW, L"",
+            WS_CHILD | WS_VISIBLE, 0, 0, 0, 0, hWnd, (HMENU)IDC_STATUS, g_hInst, nullptr);
+
+        InitListView(g_hList);
+        ResizeLayout(hWnd);
+        g_hMain = hWnd;
+        g_hashNotify = [] { PostMessageW(g_hMain, WM_APP_HASHED, 0, 0); };
+        Shm_Open();
+        Ipc_StartServer();
+        Metrics_StartServer(kMetricsPort);
+        DoRefresh(hWnd);
+        return 0;
+
+    case WM_SIZE:
+        ResizeLayout(hWnd);
+        return 0;
+
+    case WM_APP_HASHED:
+        DoRefresh(hWnd); // publishes the new digests
+        return 0;
+
+    case WM_NOTIFY:
+        if (reinterpret_cast<NMHDR*>(lParam)->idFrom == IDC_LIST) {
+            return ListView_OnNotify(reinterpret_cast<NMHDR*>(lParam));
+        }
+        break;
+
+    case WM_COMMAND:
+        switch (LOWORD(wParam)) {
+        case IDC_REFRESH:
+        case IDC_CURONLY:
+            DoRefresh(hWnd);
+            return 0;
+        case IDC_SEARCH:
+            if (HIWORD(wParam) == EN_CHANGE) ApplyFilter();
+            return 0;
+        case IDC_GROUP:
+            if (HIWORD(wParam) == CBN_SELCHANGE) {
+                g_groups.by = static_cast<GroupBy>(ComboBox_GetCurSel(g_hGroup));
+                ApplyFilter();
+            }
+            return 0;
+        }
+        break;
+
+    case WM_DESTROY:
+        PostQuitMessage(0);
+        return 0;
+    }
+    return DefWindowProcW(hWnd, msg, wParam, lParam);
+}
+
+int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int nCmdShow) {
+    g_hInst = hInstance;
+
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    bool watch = false;
+    ViewOptions view;
+    int exportAs = -1; // 0 CSV, 1 JSON
+    std::wstring policyPath;
+    unsigned intervalMs = 2000;
+    for (int i = 1; argv && i < argc; ++i) {
+        if (_wcsicmp(argv[i], L"--watch") == 0) watch = true;
+        else if (_wcsicmp(argv[i], L"--export") == 0 && i + 1 < argc) exportAs = _wcsicmp(argv[++i], L"json") == 0 ? 1 : 0;
+        else if (_wcsicmp(argv[i], L"--current") == 0) view.currentOnly = true;
+        else if (_wcsicmp(argv[i], L"--search") == 0 && i + 1 < argc) view.query = argv[++i];
+        else if (_wcsicmp(argv[i], L"--sort") == 0 && i + 1 < argc) View_ParseSort(view, argv[++i]);
+        else if (_wcsicmp(argv[i], L"--group") == 0 && i + 1 < argc) View_ParseGroup(view, argv[++i]);
+        else if (_wcsicmp(argv[i], L"--timeline") == 0 && i + 1 < argc) View_ParseTimeline(view, argv[++i]);
+        else if (_wcsicmp(argv[i], L"--all-users") == 0) g_allUsers = true;
+        else if (_wcsicmp(argv[i], L"--hash-cache") == 0 && i + 1 < argc) g_hashCachePath = argv[++i];
+        else if (_wcsicmp(argv[i], L"--policy") == 0 && i + 1 < argc) policyPath = argv[++i];
+        else if (_wcsicmp(argv[i], L"--interval") == 0 && i + 1 < argc) intervalMs = std::max(50, _wtoi(argv[++i]));
+    }
+    LocalFree(argv);
+
+    size_t badRules = 0;
+    if (!policyPath.empty() && !Policy_Load(g_policy, policyPath, badRules)) {
+        MessageBoxW(nullptr, (L"Cannot read the policy file " + policyPath).c_str(), kAppTitle, MB_ICONERROR);
+        return 1;
+    }
+    if (exportAs >= 0) {
+        if (!AttachConsole(ATTACH_PARENT_PROCESS)) AllocConsole();
+        return Export_Run(exportAs == 1, view);
+    }
+    if (watch) {
+        if (!AttachConsole(ATTACH_PARENT_PROCESS)) AllocConsole();
+        Shm_Open();
+        Ipc_StartServer();
+        Metrics_StartServer(kMetricsPort);
+        return Watch_Run(intervalMs, view);
+    }
+
+    INITCOMMONCONTROLSEX icc{ sizeof(icc), ICC_LISTVIEW_CLASSES | ICC_BAR_CLASSES };
+    InitCommonControlsEx(&icc);
+
+    WNDCLASSEXW wc{ sizeof(wc) };
+    wc.lpfnWndProc = WndProc;
+    wc.hInstance = hInstance;
+    wc.hCursor = LoadCursor(nullptr, IDC_ARROW);
+    wc.hIcon = LoadIcon(nullptr, IDI_APPLICATION);
+    wc.hIconSm = wc.hIcon;
+    wc.hbrBackground = (HBRUSH)(COLOR_WINDOW + 1);
+    wc.lpszClassName = kAppClass;
+
+    if (!RegisterClassExW(&wc)) return 0;
+
+    HWND hWnd = CreateWindowExW(0, kAppClass, kAppTitle,
+        WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+        CW_USEDEFAULT, CW_USEDEFAULT, 980, 560,
+        nullptr, nullptr, hInstance, nullptr);
+
+    if (!hWnd) return 0;
+
+    ShowWindow(hWnd, nCmdShow);
+    UpdateWindow(hWnd);
+
+    MSG msg{};
+    while (GetMessageW(&msg, nullptr, 0, 0)) {
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+    Exe_StopHashing();
+    return (int)msg.wParam;
+}
+#else
+// ---------------------- Portable Entry ----------------------
+// --inspect: one tab-separated line per file (path, product, company,
+// version, SHA-256, signer, issuer), fields empty when the file has no
+// version resource or signature.
+static int Exe_Inspect(int n, char** paths) {
+    std::vector<const ExeInfo*> infos(static_cast<size_t>(n));
+    std::vector<std::pair<const std::wstring*, ExeInfo*>> todo;
+    for (int i = 0; i < n; ++i) {
+        std::wstring path;
+        AppendWide(path, paths[i]);
+        ExeInfo* info = Exe_Lookup(path);
+        auto it = g_exeInfo.find(path);
+        if (info && !info->hashed) todo.emplace_back(&it->first, info);
+        infos[i] = info;
+    }
+    Hash_Run(todo);
+
+    std::string out;
+    int failed = 0;
+    for (int i = 0; i < n; ++i) {
+        const ExeInfo* info = infos[i];
+        if (!info) {
+            fprintf(stderr, "camusage: cannot read %s\n", paths[i]);
+            ++failed;
+            continue;
+        }
+        out += paths[i];
+        for (const std::wstring* f : { &info->product, &info->company, &info->version, &info->sha256, &info->signer, &info->signerIssuer }) {
+            out += '\t';
+            AppendUtf8(out, *f);
+        }
+        out += '\n';
+    }
+    Watch_Write(out);
+    return failed ? 1 : 0;
+}
+
+// Headless build for non-Windows hosts: refreshes on an interval and serves
+// the published snapshot, optionally rendering it with --watch. On Linux the
+// rows come from /proc (Linux Device Holders); elsewhere the list is empty.
+int main(int argc, char** argv) {
+    std::string socketPath = Ipc_DefaultSocketPath();
+    unsigned short metricsPort = kMetricsPort;
+    bool watch = false;
+    ViewOptions view;
+    const char* exportAs = nullptr;
+    const char* policyPath = nullptr;
+    unsigned intervalMs = 2000;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--ipc") == 0 && i + 1 < argc) socketPath = argv[++i];
+        else if (strcmp(argv[i], "--hash-cache") == 0 && i + 1 < argc) AppendWide(g_hashCachePath, argv[++i]);
+        else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) policyPath = argv[++i];
+        else if (strcmp(argv[i], "--inspect") == 0) return Exe_Inspect(argc - i - 1, argv + i + 1);
+        else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) exportAs = argv[++i];
+        else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) metricsPort = static_cast<unsigned short>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--watch") == 0) watch = true;
+        else if (strcmp(argv[i], "--current") == 0) view.currentOnly = true;
+        else if (strcmp(argv[i], "--search") == 0 && i + 1 < argc) AppendWide(view.query, argv[++i]);
+        else if (strcmp(argv[i], "--sort") == 0 && i + 1 < argc) {
+            std::wstring arg;
+            AppendWide(arg, argv[++i]);
+            if (!View_ParseSort(view, arg)) {
+                fprintf(stderr, "camusage: --sort takes a column name (see --export csv), optionally :desc\n");
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--group") == 0 && i + 1 < argc) {
+            std::wstring arg;
+            AppendWide(arg, argv[++i]);
+            if (!View_ParseGroup(view, arg)) {
+                fprintf(stderr, "camusage: --group takes product, publisher, directory, container or none\n");
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--timeline") == 0 && i + 1 < argc) {
+            std::wstring arg;
+            AppendWide(arg, argv[++i]);
+            if (!View_ParseTimeline(view, arg)) {
+                fprintf(stderr, "camusage: --timeline takes day, week or month\n");
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) intervalMs = std::max(50, atoi(argv[++i]));
+#ifdef __linux__
+        else if (strcmp(argv[i], "--proc-root") == 0 && i + 1 < argc) g_procRoot = argv[++i];
+        else if (strcmp(argv[i], "--dev-root") == 0 && i + 1 < argc) g_devRoot = argv[++i];
+#endif
+    }
+    if (policyPath) {
+        std::wstring path;
+        AppendWide(path, policyPath);
+        size_t bad = 0;
+        if (!Policy_Load(g_policy, path, bad)) {
+            fprintf(stderr, "camusage: cannot read %s\n", policyPath);
+            return 2;
+        }
+        if (bad) fprintf(stderr, "camusage: %s: skipped %zu lines that are not allow/deny rules\n", policyPath, bad);
+    }
+    if (exportAs) {
+        if (strcmp(exportAs, "csv") != 0 && strcmp(exportAs, "json") != 0) {
+            fprintf(stderr, "camusage: --export takes csv or json\n");
+            return 2;
+        }
+        return Export_Run(strcmp(exportAs, "json") == 0, view);
+    }
+
+    if (!Shm_Open()) {
+        fprintf(stderr, "camusage: cannot create shared memory %s (not ours?)\n", Shm_Name().c_str());
+        return 1;
+    }
+    if (!Ipc_StartServer(socketPath)) {
+        fprintf(stderr, "camusage: cannot listen on %s (in use, or not ours)\n", socketPath.c_str());
+        return 1;
+    }
+    if (metricsPort != 0 && !Metrics_StartServer(metricsPort)) {
+        fprintf(stderr, "camusage: cannot listen on 127.0.0.1:%u\n", metricsPort);
+        return 1;
+    }
+#ifdef __linux__
+    // With the device nodes watched, the interval only paces the fallback scan.
+    const bool devWatch = DevWatch_Open();
+    if (devWatch) intervalMs = std::max(intervalMs, kDeviceWatchFallbackMs);
+#endif
+    if (watch) return Watch_Run(intervalMs, view);
+    for (;;) {
+        RefreshSnapshot();
+        // While exes are being hashed, come back soon to publish the digests.
+        const unsigned waitMs = g_hashJob.thread.joinable() ? std::min(intervalMs, 1000u) : intervalMs;
+#ifdef __linux__
+        if (devWatch) {
+            DevWatch_Wait(waitMs);
+            continue;
+        }
+#endif
+        std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
+    }
+}
+#endif
@@ -0,0 +1,180 @@
+// tests/devwatch_test.cpp
+// Test for the Linux device watch (inotify on the camera and capture nodes)
+// and the /proc rescans it triggers, run against the portable build of
+// CamUsageWin.cpp. The device directory is a temp dir of regular files
+// standing in for the nodes (what --dev-root points the app at):
+//  - an open of a node calls for a full scan, which finds this process
+//  - a close calls for a holders-only scan, which stops the row
+//  - a node created after the watch started (hotplug) is watched too
+//  - a holders-only scan reads the last holders and no other process
+//    (checked against a fake /proc, as --proc-root would give)
+//
+// Build: g++ -std=c++17 -O2 tests/devwatch_test.cpp -o devwatch_test -lpthread
+// Run:   ./devwatch_test
+
+#define main camusage_main
+#include "../CamUsageWin.cpp"
+#undef main
+
+#include <filesystem>
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++g_failures; \
+        } \
+    } while (0)
+
+static std::string g_tmp; // temp dir: dev/ for the nodes, proc/ for the fake /proc
+
+static void WriteFile(const std::string& path, const char* text) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return;
+    fputs(text, f);
+    fclose(f);
+}
+
+static size_t ActiveRows(const std::vector<CamRow>& rows) {
+    size_t n = 0;
+    for (const CamRow& r : rows) n += r.activeNow;
+    return n;
+}
+
+static double MsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static void TestOpenClose() {
+    const std::string video0 = g_devRoot + "/video0";
+    std::vector<CamRow> rows;
+    Proc_Load(rows, PROC_SCAN_ALL);
+    CHECK(ActiveRows(rows) == 0);
+
+    // Nodes that are not cameras or capture devices are not watched.
+    int fd = open((g_devRoot + "/null").c_str(), O_RDONLY);
+    close(fd);
+    CHECK(!DevWatch_Wait(200));
+
+    auto t0 = std::chrono::steady_clock::now();
+    fd = open(video0.c_str(), O_RDONLY);
+    CHECK(DevWatch_Wait(5000));
+    CHECK(DevWatch_TakePending() == PROC_SCAN_ALL);
+    Proc_Load(rows, PROC_SCAN_ALL);
+    double openMs = MsSince(t0);
+    CHECK(ActiveRows(rows) == 1);
+    CHECK(g_procRows.holderPids == std::vector<int>{ getpid() });
+
+    t0 = std::chrono::steady_clock::now();
+    close(fd);
+    CHECK(DevWatch_Wait(5000));
+    CHECK(DevWatch_TakePending() == PROC_SCAN_HOLDERS);
+    Proc_Load(rows, PROC_SCAN_HOLDERS);
+    double closeMs = MsSince(t0);
+    CHECK(ActiveRows(rows) == 0);
+    CHECK(rows.size() == 1 && rows[0].stopFt != 0);
+    CHECK(g_procRows.holderPids.empty());
+    printf("open seen and scanned in %.1f ms, close in %.1f ms\n", openMs, closeMs);
+}
+
+static void TestHotplug() {
+    const std::string video7 = g_devRoot + "/video7";
+    std::vector<CamRow> rows;
+    CHECK(g_devWatch.nodes.size() == 1);
+
+    WriteFile(video7, "");
+    CHECK(DevWatch_Wait(5000));
+    CHECK(DevWatch_TakePending() == PROC_SCAN_ALL); // it may have been opened before the watch
+    CHECK(g_devWatch.nodes.size() == 2);
+
+    int fd = open(video7.c_str(), O_RDONLY);
+    CHECK(DevWatch_Wait(5000));
+    Proc_Load(rows, DevWatch_TakePending());
+    CHECK(ActiveRows(rows) == 1);
+    close(fd);
+    CHECK(DevWatch_Wait(5000));
+    Proc_Load(rows, DevWatch_TakePending());
+    CHECK(ActiveRows(rows) == 0);
+
+    unlink(video7.c_str());
+    DevWatch_Wait(500);
+    CHECK(g_devWatch.nodes.size() == 1);
+    DevWatch_TakePending();
+}
+
+// Process 100 holds video0 and 200 does not. Then 200 gets the node without
+// opening it (an inherited fd: no event) and 100 lets go of it: the close
+// event's scan looks at 100 only, and only a full scan finds 200.
+static void TestHoldersOnlyScan() {
+    const std::string proc = g_tmp + "/proc";
+    const std::string video0 = g_devRoot + "/video0";
+    const std::string null = g_devRoot + "/null";
+    std::filesystem::create_directories(proc + "/100/fd");
+    std::filesystem::create_directories(proc + "/200/fd");
+    WriteFile(proc + "/stat", "cpu 0\nbtime 1700000000\n");
+    WriteFile(proc + "/100/stat", "100 (cheese) S 1 1 1 0 -1 0 0 0 0 0 0 0 0 0 20 0 1 0 500 0 0\n");
+    WriteFile(proc + "/200/stat", "200 (obs) S 1 1 1 0 -1 0 0 0 0 0 0 0 0 0 20 0 1 0 700 0 0\n");
+    auto link = [&](const std::string& target, const std::string& at) {
+        unlink(at.c_str());
+        CHECK(symlink(target.c_str(), at.c_str()) == 0);
+    };
+    link(video0, proc + "/100/fd/3");
+    link(null, proc + "/200/fd/3");
+
+    g_procRows = ProcRows();
+    g_procRoot = proc;
+    std::vector<CamRow> rows;
+    Proc_Load(rows, PROC_SCAN_ALL);
+    CHECK(g_procRows.holderPids == std::vector<int>{ 100 });
+    CHECK(ActiveRows(rows) == 1 && rows[0].app == L"cheese");
+
+    int fd = open(video0.c_str(), O_RDONLY);
+    CHECK(DevWatch_Wait(5000));
+    DevWatch_TakePending();
+    link(null, proc + "/100/fd/3");
+    link(video0, proc + "/200/fd/3");
+    close(fd);
+    CHECK(DevWatch_Wait(5000));
+    const int mode = DevWatch_TakePending();
+    CHECK(mode == PROC_SCAN_HOLDERS);
+    Proc_Load(rows, mode);
+    CHECK(g_procRows.holderPids.empty());
+    CHECK(ActiveRows(rows) == 0);
+
+    Proc_Load(rows, PROC_SCAN_ALL);
+    CHECK(g_procRows.holderPids == std::vector<int>{ 200 });
+    CHECK(ActiveRows(rows) == 1);
+    for (const CamRow& r : rows) CHECK(r.activeNow == (r.app == L"obs"));
+}
+
+int main() {
+    char dir[] = "/tmp/devwatch_test.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    g_tmp = dir;
+    g_devRoot = g_tmp + "/dev";
+    std::filesystem::create_directories(g_devRoot);
+    WriteFile(g_devRoot + "/video0", "");
+    WriteFile(g_devRoot + "/null", "");
+
+    if (!DevWatch_Open()) {
+        fprintf(stderr, "inotify is not available\n");
+        ++g_failures;
+    }
+    else {
+        TestOpenClose();
+        TestHotplug();
+        TestHoldersOnlyScan();
+    }
+    std::filesystem::remove_all(g_tmp);
+    if (g_failures) {
+        fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    puts("devwatch_test: ok");
+    return 0;
+}
@@ -0,0 +1,268 @@
+// tests/rowview_test.cpp
+// Unit test and benchmark for the row view model behind the owner-data
+// ListView, run against the portable build of CamUsageWin.cpp:
+//  - the Current-only filter
+//  - the formatted-cell window and its prefetch around a miss
+//  - sorting with tracked items (selection, focus) following their rows
+//  - applying the next snapshot's diff instead of rebuilding the list
+//
+// Build: g++ -std=c++17 -O2 tests/rowview_test.cpp -o rowview_test -lpthread
+// Run:   ./rowview_test [rows]   (rows for the benchmark, default 100000)
+
+#define main camusage_main
+#include "../CamUsageWin.cpp"
+#undef main
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++g_failures; \
+        } \
+    } while (0)
+
+static double MsSince(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// n distinct rows; salt moves the activity and times so a second call with a
+// different salt looks like a later scan of the same apps.
+static std::vector<CamRow> MakeRows(size_t n, unsigned salt) {
+    std::vector<CamRow> rows(n);
+    for (size_t i = 0; i < n; ++i) {
+        CamRow& r = rows[i];
+        r.kind = i % 7 ? L"Desktop" : L"Packaged";
+        r.capability = i % 3 ? L"webcam" : L"microphone";
+        r.app = L"app" + std::to_wstring(i) + L".exe";
+        r.exe = L"C:\\Program Files\\Vendor" + std::to_wstring(i % 97) + L"\\bin\\" + r.app;
+        r.activeNow = (i * 2654435761u + salt) % 5 == 0;
+        r.startFt = 133000000000000000ULL + (i * 7919 % 100000) * kTicksPerSecond;
+        r.stopFt = r.activeNow ? 0 : r.startFt + 60 * kTicksPerSecond;
+    }
+    return rows;
+}
+
+static std::shared_ptr<const Snapshot> Publish(std::vector<CamRow>& rows) {
+    PublishSnapshot(rows);
+    return CurrentSnapshot();
+}
+
+static std::wstring TimeText(const CamRow& r, int col) {
+    std::wstring buf;
+    return kColumnInfo[col].text(r, buf);
+}
+
+static const CamRow& RowAt(const RowView& v, size_t item) {
+    return v.snap->rows[v.items[item]];
+}
+
+static void TestCurrentOnly() {
+    std::vector<CamRow> rows = MakeRows(200, 0);
+    std::shared_ptr<const Snapshot> snap = Publish(rows);
+    RowView all, current;
+    RowView_Reset(all, snap, false);
+    RowView_Reset(current, snap, true);
+
+    size_t active = 0;
+    for (const CamRow& r : snap->rows) active += r.activeNow;
+    CHECK(RowView_Count(all) == snap->rows.size());
+    CHECK(RowView_Count(current) == active);
+    CHECK(active > 0 && active < snap->rows.size());
+    for (size_t i = 0; i < RowView_Count(current); ++i) CHECK(RowAt(current, i).activeNow);
+    CHECK(std::wstring(RowView_Cell(current, 0, COL_ACTIVE)) == L"Yes");
+}
+
+static void TestPrefetchWindow() {
+    std::vector<CamRow> rows = MakeRows(1000, 0);
+    std::shared_ptr<const Snapshot> snap = Publish(rows);
+    RowView v;
+    RowView_Reset(v, snap, false);
+    CHECK(v.window.empty());
+
+    // Text columns come straight from the row and leave the window alone.
+    CHECK(std::wstring(RowView_Cell(v, 500, COL_APP)) == RowAt(v, 500).app);
+    CHECK(v.window.empty());
+
+    // A Time cell miss formats a page around the item plus a page either side.
+    CHECK(std::wstring(RowView_Cell(v, 500, COL_START)) == TimeText(RowAt(v, 500), COL_START));
+    const size_t first = v.first, size = v.window.size();
+    CHECK(first <= 500 - kRowViewPage / 2 - kRowViewPage);
+    CHECK(first + size >= 500 + kRowViewPage / 2 + kRowViewPage);
+
+    // Anything inside it is a hit: the window does not move.
+    CHECK(std::wstring(RowView_Cell(v, first, COL_STOP)) == TimeText(RowAt(v, first), COL_STOP));
+    CHECK(std::wstring(RowView_Cell(v, first + size - 1, COL_START)) == TimeText(RowAt(v, first + size - 1), COL_START));
+    CHECK(v.first == first && v.window.size() == size);
+
+    // The list's hint for what it is about to show moves the window ahead of
+    // the next miss, with a span of neighbors on each side.
+    RowView_Prefetch(v, 900, 919);
+    CHECK(v.first == 880 && v.window.size() == 60);
+    for (size_t i = v.first; i < v.first + v.window.size(); ++i) {
+        CHECK(v.window[i - v.first].text[COL_START] == TimeText(RowAt(v, i), COL_START));
+    }
+    RowView_Prefetch(v, 990, 2000); // clipped at the end of the list
+    CHECK(v.first + v.window.size() == RowView_Count(v));
+    CHECK(std::wstring(RowView_Cell(v, RowView_Count(v), COL_START)).empty());
+}
+
+static void TestSortTracksSelection() {
+    std::vector<CamRow> rows = MakeRows(300, 0);
+    std::shared_ptr<const Snapshot> snap = Publish(rows);
+    RowView v;
+    RowView_Reset(v, snap, false);
+
+    std::vector<size_t> tracked = { 0, 17, 299, 5000 };
+    std::vector<std::wstring> apps;
+    for (size_t i = 0; i < 3; ++i) apps.push_back(RowAt(v, tracked[i]).app);
+
+    RowView_SetSort(v, COL_EXE, false, tracked);
+    for (size_t i = 1; i < RowView_Count(v); ++i) {
+        CHECK(!RowView_Less(*v.snap, COL_EXE, v.items[i], v.items[i - 1]));
+    }
+    for (size_t i = 0; i < 3; ++i) CHECK(tracked[i] < RowView_Count(v) && RowAt(v, tracked[i]).app == apps[i]);
+    CHECK(tracked[3] == SIZE_MAX);
+
+    // Same column, other direction: an exact reversal.
+    std::vector<uint32_t> ascending = v.items;
+    RowView_SetSort(v, COL_EXE, true, tracked);
+    CHECK(std::equal(v.items.begin(), v.items.end(), ascending.rbegin()));
+    for (size_t i = 0; i < 3; ++i) CHECK(RowAt(v, tracked[i]).app == apps[i]);
+
+    RowView_SetSort(v, COL_START, true, tracked);
+    for (size_t i = 1; i < RowView_Count(v); ++i) {
+        CHECK(!RowView_Less(*v.snap, COL_START, v.items[i - 1], v.items[i]));
+    }
+    for (size_t i = 0; i < 3; ++i) CHECK(RowAt(v, tracked[i]).app == apps[i]);
+}
+
+// Applies next to a view sorted by col and checks it against a view built
+// from scratch: same items, every item whose text changed inside a dirty
+// range, tracked items still on their rows.
+static void CheckApply(int col, bool desc, bool currentOnly) {
+    std::vector<CamRow> rows = MakeRows(400, 0);
+    std::shared_ptr<const Snapshot> snap = Publish(rows);
+    RowView v;
+    RowView_Reset(v, snap, currentOnly);
+    std::vector<size_t> none;
+    if (col >= 0) RowView_SetSort(v, col, desc, none);
+
+    std::vector<std::wstring> before;
+    for (size_t i = 0; i < RowView_Count(v); ++i) {
+        before.push_back(RowAt(v, i).app + L"|" + RowView_Cell(v, i, COL_ACTIVE) + L"|" + RowView_Cell(v, i, COL_START));
+    }
+    std::vector<size_t> tracked = { 0, RowView_Count(v) / 2, RowView_Count(v) - 1 };
+    std::vector<std::wstring> apps;
+    for (size_t t : tracked) apps.push_back(RowAt(v, t).app);
+
+    // Next scan: some sessions start or stop, one app is gone, two are new.
+    for (size_t i = 0; i < rows.size(); i += 9) {
+        rows[i].activeNow = !rows[i].activeNow;
+        rows[i].startFt += 3600 * kTicksPerSecond;
+        rows[i].stopFt = rows[i].activeNow ? 0 : rows[i].startFt + kTicksPerSecond;
+    }
+    const std::wstring gone = RowAt(v, tracked[1]).app;
+    rows.erase(std::find_if(rows.begin(), rows.end(), [&](const CamRow& r) { return r.app == gone; }));
+    rows.push_back(MakeRows(1, 0)[0]);
+    rows.back().app = L"aaa-new.exe";
+    rows.back().activeNow = true;
+    rows.push_back(rows.back());
+    rows.back().app = L"zzz-new.exe";
+    std::shared_ptr<const Snapshot> next = Publish(rows);
+
+    std::vector<uint8_t> match;
+    std::vector<std::pair<size_t, size_t>> dirty;
+    CHECK(RowView_Apply(v, next, match, tracked, dirty));
+
+    RowView fresh;
+    RowView_Reset(fresh, next, currentOnly);
+    if (col >= 0) RowView_SetSort(fresh, col, desc, none);
+    CHECK(v.items == fresh.items);
+
+    for (size_t i = 1; i < dirty.size(); ++i) CHECK(dirty[i - 1].second + 1 < dirty[i].first);
+    size_t common = std::min(before.size(), RowView_Count(v));
+    for (size_t i = 0; i < common; ++i) {
+        std::wstring now = RowAt(v, i).app + L"|" + RowView_Cell(v, i, COL_ACTIVE) + L"|" + RowView_Cell(v, i, COL_START);
+        if (now == before[i]) continue;
+        bool covered = false;
+        for (const auto& d : dirty) covered |= d.first <= i && i <= d.second;
+        CHECK(covered);
+    }
+
+    CHECK(tracked[1] == SIZE_MAX);
+    for (size_t t : { 0, 2 }) {
+        if (tracked[t] == SIZE_MAX) CHECK(currentOnly); // the session stopped
+        else CHECK(RowAt(v, tracked[t]).app == apps[t]);
+    }
+
+    // Only the snapshot right after the view's can be applied.
+    Publish(rows);
+    std::shared_ptr<const Snapshot> skipped = Publish(rows);
+    CHECK(!RowView_Apply(v, skipped, match, tracked, dirty));
+}
+
+static void TestApplyDiff() {
+    CheckApply(-1, false, false);
+    CheckApply(COL_APP, false, false);
+    CheckApply(COL_START, true, false);
+    CheckApply(COL_EXE, false, true);
+}
+
+static void Benchmark(size_t n) {
+    std::vector<CamRow> rows = MakeRows(n, 1);
+    auto t0 = std::chrono::steady_clock::now();
+    std::shared_ptr<const Snapshot> snap = Publish(rows);
+    double publish = MsSince(t0);
+
+    RowView v;
+    std::vector<size_t> tracked = { n / 3 };
+    t0 = std::chrono::steady_clock::now();
+    RowView_Reset(v, snap, false);
+    RowView_SetSort(v, COL_START, true, tracked);
+    double build = MsSince(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    for (size_t top = 0; top + 40 < n; top += 40) {
+        RowView_Prefetch(v, top, top + 39);
+        for (size_t i = top; i < top + 40; ++i) RowView_Cell(v, i, COL_START);
+    }
+    double scroll = MsSince(t0);
+
+    for (size_t i = 0; i < n; i += 100) {
+        rows[i].activeNow = !rows[i].activeNow;
+        rows[i].startFt += kTicksPerSecond;
+    }
+    std::shared_ptr<const Snapshot> next = Publish(rows);
+    std::vector<uint8_t> match;
+    std::vector<std::pair<size_t, size_t>> dirty;
+    t0 = std::chrono::steady_clock::now();
+    bool applied = RowView_Apply(v, next, match, tracked, dirty);
+    double apply = MsSince(t0);
+
+    RowView fresh;
+    t0 = std::chrono::steady_clock::now();
+    RowView_Reset(fresh, next, false);
+    RowView_SetSort(fresh, COL_START, true, tracked);
+    double rebuild = MsSince(t0);
+
+    printf("%zu rows: publish %.1f ms; build sorted by Last Start %.1f ms; scroll through %.1f ms; "
+        "next snapshot (1%% changed) %.2f ms applied%s, %.1f ms rebuilt; %zu dirty ranges\n",
+        n, publish, build, scroll, apply, applied ? "" : " (FAILED)", rebuild, dirty.size());
+    CHECK(applied && v.items == fresh.items);
+}
+
+int main(int argc, char** argv) {
+    TestCurrentOnly();
+    TestPrefetchWindow();
+    TestSortTracksSelection();
+    TestApplyDiff();
+    Benchmark(argc > 1 ? static_cast<size_t>(atol(argv[1])) : 100000);
+    if (g_failures) {
+        fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    puts("rowview_test: ok");
+    return 0;
+}